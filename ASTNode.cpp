@@ -1,17 +1,102 @@
 #include <string>
+#include <unordered_map>
 #include <vector>
+#include <unordered_set>
+#include <algorithm>
 #include <fstream>
+#include <ostream>
+#include <cstdio>
+#include <climits>
+#include <csignal>
 
 using namespace std;
 
+class BytecodeCompiler;
+class Columns;
+class Arena;
+
+/**
+ * Result of the code generation of an expression: an integer constant or the number of a temporary
+ * */
+struct Value
+{
+    bool temporary;
+    int number;
+};
+
+/**
+ * Name of a basic block, written as <kind>_<index><part> like cond_3body.
+ * Labels with a negative index are written as <kind> only
+ * */
+struct Label
+{
+    const char *kind;
+    int index;
+    const char *part;
+};
+
+/**
+ * Reciprocal of a divisor that does not change in a while loop, calculated in front of the loop
+ * */
+struct Reciprocal
+{
+    Value divisor;    //the divisor it belongs to
+    Value multiplier; //i128, ceil(2^64 / |divisor|)
+    Value usable;     //i1, false for the divisors 0, 1 and -1, which are divided with sdiv
+};
+
+/**
+ * Writes IR code into a growing byte buffer instead of streaming every fragment separately.
+ * Numbers and temporaries are formatted straight into the buffer, the buffer is written to
+ * the output in large blocks by flushIfFull() and flush()
+ * */
+class IREmitter
+{
+public:
+    ostream &output;
+    char *buffer;
+    size_t size;
+    size_t capacity;
+
+    //State of the code generation of one program
+    int tempIndex;                       //number of the next temporary
+    int conditionalIndex;                //number of the next if/while, used in its labels
+    int chooseIndex;                     //number of the next choose, used in its labels
+    int divisionIndex;                   //number of the next division that branches, used in its labels
+    vector<Value> values;                //SSA value of every variable slot at the current point of code generation
+    unordered_map<int, Reciprocal> reciprocals; //reciprocals of the divisors of the loops being generated, by slot
+    Label block;                         //label of the basic block code is being generated into
+
+    IREmitter(ostream &_output);
+    ~IREmitter();
+
+    IREmitter &operator<<(const char *text);
+    IREmitter &operator<<(char character);
+    IREmitter &operator<<(int number);
+    IREmitter &operator<<(Value value);
+    IREmitter &operator<<(const Label &label);
+
+    Value temporary();
+    size_t mark();
+    void moveTo(size_t mark, size_t start);
+    void flushIfFull();
+    void flush();
+
+private:
+    void reserve(size_t length);
+};
+
 /**
  * Abstract class for Asynchronous Syntax Tree
  * */
 class ASTNode
 {
 public:
-    static int tempIndex;
-    virtual string generateCode(ofstream &output) = 0;
+    virtual Value generateCode(IREmitter &output) = 0;
+    virtual int evaluate(vector<int> &variables) = 0;
+    virtual int compile(BytecodeCompiler &compiler, int target) = 0;
+    virtual ASTNode *fold(Arena &arena) = 0;
+    virtual const int *evaluateColumns(Columns &columns, const int *mask) = 0;
  };
 
 /**
@@ -20,9 +105,14 @@ public:
 class IdentifierNode : public ASTNode
 {
 public:
-    string name;
-    IdentifierNode(string _name);
-    string generateCode(ofstream &output);
+    const char *name;
+    int slot; //index of the variable in Parser::variables and in the variables of every backend
+    IdentifierNode(const char *_name, int _slot);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
     string getID();
 };
 
@@ -33,9 +123,13 @@ public:
 class NumberNode : public ASTNode
 {
 public:
-    string value;
-    NumberNode(string _value);
-    string generateCode(ofstream &output);
+    int value;
+    NumberNode(int _value);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
 };
 
 /**
@@ -46,9 +140,12 @@ class ChooseNode : public ASTNode
 {
 public:
     ASTNode *expr1, *expr2, *expr3, *expr4;
-    static int chooseIndex;
     ChooseNode(ASTNode *_expr1, ASTNode *_expr2, ASTNode *_expr3, ASTNode *_expr4);
-    string generateCode(ofstream &output);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
 };
 
 /**
@@ -63,7 +160,46 @@ public:
     char operation;
 
     BinaryOperationNode(ASTNode *_left, ASTNode *_right, char _operation);
-    string generateCode(ofstream &output);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node for division by a constant divisor, fold() creates it from BinaryOperationNode.
+ * The division is calculated with a multiplication and shifts instead of a division instruction
+ * */
+class ConstantDivisionNode : public ASTNode
+{
+public:
+    ASTNode *dividend;
+    int divisor;    //anything but 0, 1 and -1
+    int multiplier; //0 if the absolute value of divisor is a power of two
+    int shift;
+
+    ConstantDivisionNode(ASTNode *_dividend, int _divisor);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node for a division that always traps, by zero or INT_MIN / -1. fold() creates it from
+ * BinaryOperationNode, the operands are dropped since the division traps whatever they calculate
+ * */
+class TrapNode : public ASTNode
+{
+public:
+    TrapNode();
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
 };
 
 /**
@@ -74,7 +210,11 @@ class PrintNode : public ASTNode
 public:
     ASTNode *expr;
     PrintNode(ASTNode *_expr);
-    string generateCode(ofstream &output);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
 };
 
 /**
@@ -84,13 +224,16 @@ public:
 class ConditionalNode : public ASTNode
 {
 public:
-    static int conditionalIndex;
     int type;
     ASTNode *condition;
     vector<ASTNode *> statements;
 
     ConditionalNode(int _type, ASTNode *_condition);
-    string generateCode(ofstream &output);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
 };
 
 /**
@@ -103,29 +246,95 @@ public:
     IdentifierNode *identifier;
     ASTNode *expr;
     AssignNode(IdentifierNode *id, ASTNode *expr);
-    string generateCode(ofstream &output);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
 };
 
+/**
+ * Where the print statements of evaluate() and the bytecode VM write to, stdout when NULL.
+ * The server points it to the output of the request its thread runs
+ * */
+thread_local FILE *programOutput = NULL;
+
+/**
+ * Arithmetic on i32 values for evaluate(). Results wrap around like add, sub and mul in the IR code
+ * */
+int add(int left, int right)
+{
+    return (int)((unsigned)left + (unsigned)right);
+}
+
+int subtract(int left, int right)
+{
+    return (int)((unsigned)left - (unsigned)right);
+}
+
+int multiply(int left, int right)
+{
+    return (int)((unsigned)left * (unsigned)right);
+}
+
+/**
+ * Divides like sdiv. Division by zero and INT_MIN / -1 raise SIGFPE
+ * as the division instruction does in the compiled code
+ * */
+int divide(int left, int right)
+{
+    if (right == 0 || (left == INT_MIN && right == -1))
+    {
+        raise(SIGFPE);
+        return 0;
+    }
+
+    return left / right;
+}
+
+/**
+ * Generates a division that traps with SIGFPE like divide() does: zero divided by zero, both loaded
+ * from @division.zero. The loads and the store of the quotient are volatile, so LLVM can neither fold
+ * the division nor remove it when the quotient is not used
+ * */
+static Value trapCode(IREmitter &output)
+{
+    Value dividend = output.temporary();
+    Value divisor = output.temporary();
+    Value quotient = output.temporary();
+
+    output << '\t' << dividend << " = load volatile i32, i32* @division.zero\n"
+           << '\t' << divisor << " = load volatile i32, i32* @division.zero\n"
+           << '\t' << quotient << " = sdiv i32 " << dividend << ", " << divisor << '\n'
+           << "\tstore volatile i32 " << quotient << ", i32* @division.zero\n";
+
+    return quotient;
+}
 
 /***********
  * IdentifierNode
  *************/
 
-IdentifierNode::IdentifierNode(string _name)
+IdentifierNode::IdentifierNode(const char *_name, int _slot)
 {
     this->name = _name;
+    this->slot = _slot;
 }
 
 /**
- * Loads given variable to a temp variable
+ * Returns the SSA value the variable has at this point, no code is generated
  * */
-string IdentifierNode::generateCode(ofstream &output)
+Value IdentifierNode::generateCode(IREmitter &output)
 {
-    string id = "%temp_var" + to_string(tempIndex);
-    tempIndex++;
-    output << "\t" << id << " = load i32, i32* %" << name << "\n";
+    return output.values[slot];
+}
 
-    return id;
+/**
+ * Returns the current value of the variable, variables that are not assigned yet are 0
+ * */
+int IdentifierNode::evaluate(vector<int> &variables)
+{
+    return variables[slot];
 }
 
 /**
@@ -142,7 +351,7 @@ string IdentifierNode::getID()
  * NumberNode
  * **************/
 
-NumberNode::NumberNode(string _value)
+NumberNode::NumberNode(int _value)
 {
     this->value = _value;
 }
@@ -150,7 +359,12 @@ NumberNode::NumberNode(string _value)
 /**
  * Returns the value of number for expression code generation
  * */
-string NumberNode::generateCode(ofstream &output)
+Value NumberNode::generateCode(IREmitter &output)
+{
+    return Value{false, this->value};
+}
+
+int NumberNode::evaluate(vector<int> &variables)
 {
     return this->value;
 }
@@ -168,73 +382,121 @@ ChooseNode::ChooseNode(ASTNode *_expr1, ASTNode *_expr2, ASTNode *_expr3, ASTNod
 }
 
 /**
- * Generates code for choose function with expressions inside it.
- * It uses a branching approach to calculate the result of choose function
+ * Operations, constant divisions and chooses nested deeper than this generate their operands with
+ * generateExpression() instead of recursive calls
  * */
-string ChooseNode::generateCode(ofstream &output)
-{
-    string labelName = "choose_" + to_string(chooseIndex);
-    chooseIndex++;
+static const int recursionLimit = 1000;
 
-    string ret_var = "%temp_var" + to_string(tempIndex);
-    tempIndex++;
-    output << "\t" << ret_var << " = alloca i32\n"
-           << "\tstore i32 0, i32* " << ret_var << "\n";
+static thread_local int expressionDepth = 0;
 
-    string labelif = labelName + "if";
-    string el = labelName + "else";
-    string elif = labelName + "elif";
-    string end = labelName + "end";
+static Value generateExpression(IREmitter &output, ASTNode *expression);
+static int evaluateExpression(ASTNode *expression, vector<int> &variables);
 
-    string id1 = this->expr1->generateCode(output);
+/**
+ * Generates the part of a choose that comes after its expression number stage (1 to 4), ids holds the
+ * values of the expressions generated so far. The blocks the expressions end in are kept in ends for
+ * the phi. Returns the value of the choose after the last stage
+ * */
+static Value chooseCode(IREmitter &output, int index, int stage, Value *ids, Label *ends)
+{
+    Label ifBody = {"choose", index, "ifbody"};
+    Label elif = {"choose", index, "elif"};
+    Label elifBody = {"choose", index, "elifbody"};
+    Label el = {"choose", index, "else"};
+    Label end = {"choose", index, "end"};
 
-    output << "\tbr label %" << labelif << "\n\n";
+    if (stage > 1)
+    {
+        ends[stage - 2] = output.block;
+        output << "\tbr label %" << end << "\n\n";
+    }
 
-    //IF COND
-    output << labelif << ":\n";
-    string tempVar1 = "%temp_var" + to_string(tempIndex);
-    tempIndex++;
-    output << "\t" << tempVar1 << " = icmp eq i32 " << id1 << ", 0\n";
-    output << "\tbr i1 " << tempVar1 << ", label %" << labelif << "body, label %" << elif << "\n\n";
+    switch (stage)
+    {
+    case (1):
+    {
+        //IF COND
+        Value tempVar1 = output.temporary();
+        output << '\t' << tempVar1 << " = icmp eq i32 " << ids[0] << ", 0\n";
+        output << "\tbr i1 " << tempVar1 << ", label %" << ifBody << ", label %" << elif << "\n\n";
+
+        //IF BODY, the expressions may contain choose so the blocks they end in are kept for the phi
+        output << ifBody << ":\n";
+        output.block = ifBody;
+        break;
+    }
+    case (2):
+    {
+        //ELSE IF COND
+        output << elif << ":\n";
+        Value tempVar3 = output.temporary();
+        output << '\t' << tempVar3 << " = icmp sgt i32 " << ids[0] << ", 0\n";
+        output << "\tbr i1 " << tempVar3 << ", label %" << elifBody << ", label %" << el << "\n\n";
+
+        //ELSE IF BODY
+        output << elifBody << ":\n";
+        output.block = elifBody;
+        break;
+    }
+    case (3):
+        //ELSE BODY
+        output << el << ":\n";
+        output.block = el;
+        break;
+    default:
+    {
+        //END
+        output << end << ":\n";
+        output.block = end;
+        Value tempVar6 = output.temporary();
+        output << '\t' << tempVar6 << " = phi i32 [ " << ids[1] << ", %" << ends[0] << " ], [ " << ids[2] << ", %" << ends[1]
+               << " ], [ " << ids[3] << ", %" << ends[2] << " ]\n";
+
+        return tempVar6;
+    }
+    }
 
-    //IF BODY
-    output << labelif << "body:\n";
-    string tempVar2 = "%temp_var" + to_string(tempIndex);
-    tempIndex++;
-    string id2 = this->expr2->generateCode(output);
-    output << "\tstore i32 " << id2 << ", i32* " << ret_var << "\n"
-           << "\tbr label %" << end << "\n\n";
+    return ids[stage - 1];
+}
 
-    //ELSE IF COND
-    output << elif << ":\n";
-    string tempVar3 = "%temp_var" + to_string(tempIndex);
-    tempIndex++;
-    output << "\t" << tempVar3 << " = icmp sgt i32 " << id1 << ", 0\n";
-    output << "\tbr i1 " << tempVar3 << ",label %" << elif << "body, label %" << el << "\n\n";
-
-    //ELSE IF BODY
-    output << elif << "body:\n";
-    string tempVar4 = "%temp_var" + to_string(tempIndex);
-    tempIndex++;
-    string id3 = this->expr3->generateCode(output);
-    output << "\tstore i32 " << id3 << ", i32* " << ret_var << "\n"
-           << "\tbr label %" << end << "\n\n";
+Value ChooseNode::generateCode(IREmitter &output)
+{
+    if (expressionDepth >= recursionLimit)
+        return generateExpression(output, this);
+
+    ASTNode *expressions[] = {this->expr1, this->expr2, this->expr3, this->expr4};
+    Value ids[4];
+    Label ends[3];
+    Value result;
+    int index = output.chooseIndex;
+    output.chooseIndex++;
+
+    expressionDepth++;
+    for (int stage = 1; stage <= 4; stage++)
+    {
+        ids[stage - 1] = expressions[stage - 1]->generateCode(output);
+        result = chooseCode(output, index, stage, ids, ends);
+    }
+    expressionDepth--;
 
-    //ELSE BODY
-    output << el << ":\n";
-    string tempVar5 = "%temp_var" + to_string(tempIndex);
-    tempIndex++;
-    string id4 = this->expr4->generateCode(output);
-    output << "\tstore i32 " << id4 << ", i32* " << ret_var << "\n"
-           << "\tbr label %" << end << "\n\n";
+    return result;
+}
 
-    //END
-    output << end << ":\n";
-    string tempVar6 = "%temp_var" + to_string(tempIndex);
-    tempIndex++;
-    output << "\t" << tempVar6 << " = load i32, i32* " << ret_var << "\n";
+/**
+ * Evaluates the first expression and only the expression it chooses
+ * */
+int ChooseNode::evaluate(vector<int> &variables)
+{
+    if (expressionDepth >= recursionLimit)
+        return evaluateExpression(this, variables);
+
+    expressionDepth++;
+    int value = this->expr1->evaluate(variables);
+    ASTNode *chosen = value == 0 ? this->expr2 : value > 0 ? this->expr3 : this->expr4;
+    int result = chosen->evaluate(variables);
+    expressionDepth--;
 
-    return tempVar6;
+    return result;
 }
 
 /****************
@@ -250,19 +512,159 @@ BinaryOperationNode::BinaryOperationNode(ASTNode *_left, ASTNode *_right, char _
 
 
 /**
- * Generates code for binary operations by calling left and right handside code generation first
+ * Generates sdiv for a divisor that may be 0 or -1. sdiv is undefined behaviour in LLVM when it
+ * would trap, and once SSA turns the divisor into a constant LLVM folds such a division into any
+ * value or drops it. So the division first branches to trapCode() if it would trap, and divides by
+ * 1 after it in case the signal is ignored. Divisions that can not trap divide directly
+ * */
+static Value divisionCode(IREmitter &output, Value dividend, Value divisor)
+{
+    bool zero = !divisor.temporary && divisor.number == 0;
+    bool minusOne = !divisor.temporary && divisor.number == -1;
+    bool minimum = dividend.temporary || dividend.number == INT_MIN; //the dividend may be INT_MIN
+
+    if (zero || (minusOne && !dividend.temporary && dividend.number == INT_MIN))
+        return trapCode(output);
+
+    if (!divisor.temporary && !(minusOne && minimum))
+    {
+        Value quotient = output.temporary();
+        output << '\t' << quotient << " = sdiv i32 " << dividend << " , " << divisor << '\n';
+        return quotient;
+    }
+
+    int index = output.divisionIndex;
+    output.divisionIndex++;
+
+    Label trap = {"div", index, "trap"};
+    Label divide = {"div", index, "ok"};
+    Label before = output.block;
+
+    //Traps if the divisor is 0, or -1 with INT_MIN as the dividend
+    Value traps = output.temporary();
+
+    if (!divisor.temporary)
+        output << '\t' << traps << " = icmp eq i32 " << dividend << ", " << INT_MIN << '\n';
+    else if (!minimum)
+        output << '\t' << traps << " = icmp eq i32 " << divisor << ", 0\n";
+    else
+    {
+        Value isZero = output.temporary();
+        Value isMinusOne = output.temporary();
+        Value isMinimum = output.temporary();
+        Value overflows = output.temporary();
+
+        output << '\t' << isZero << " = icmp eq i32 " << divisor << ", 0\n"
+               << '\t' << isMinusOne << " = icmp eq i32 " << divisor << ", -1\n"
+               << '\t' << isMinimum << " = icmp eq i32 " << dividend << ", " << INT_MIN << '\n'
+               << '\t' << overflows << " = and i1 " << isMinusOne << ", " << isMinimum << '\n'
+               << '\t' << traps << " = or i1 " << isZero << ", " << overflows << '\n';
+    }
+
+    output << "\tbr i1 " << traps << ", label %" << trap << ", label %" << divide << "\n\n";
+
+    output << trap << ":\n";
+    trapCode(output);
+    output << "\tbr label %" << divide << "\n\n";
+
+    output << divide << ":\n";
+    output.block = divide;
+
+    Value safeDivisor = output.temporary();
+    Value quotient = output.temporary();
+    output << '\t' << safeDivisor << " = phi i32 [ 1, %" << trap << " ], [ " << divisor << ", %" << before << " ]\n"
+           << '\t' << quotient << " = sdiv i32 " << dividend << " , " << safeDivisor << '\n';
+
+    return quotient;
+}
+
+/**
+ * Divides by a loop invariant divisor with its reciprocal: the high 64 bits of |n| * ceil(2^64 / |d|)
+ * are |n| / |d| for every 32 bit n (Lemire, Kaser and Kurz, "Faster remainder by direct computation").
+ * Signs are handled with masks instead of selects. Divisors without a usable reciprocal branch to
+ * divisionCode(), so division by zero and INT_MIN / -1 trap as before
  * */
-string BinaryOperationNode::generateCode(ofstream &output)
+static Value divideByReciprocal(IREmitter &output, Value dividend, Reciprocal &reciprocal)
 {
-    string tempId, operand1, operand2, opType;
-    operand1 = left->generateCode(output);  //Generate left side code
-    operand2 = right->generateCode(output); //Generate right side code
+    int index = output.divisionIndex;
+    output.divisionIndex++;
+
+    Label fast = {"div", index, "fast"};
+    Label slow = {"div", index, "slow"};
+    Label end = {"div", index, "end"};
+
+    output << "\tbr i1 " << reciprocal.usable << ", label %" << fast << ", label %" << slow << "\n\n";
+
+    output << fast << ":\n";
+
+    Value sign = output.temporary();
+    Value flipped = output.temporary();
+    Value absolute = output.temporary();
+    Value extended = output.temporary();
+    Value product = output.temporary();
+    Value high = output.temporary();
+    Value quotient = output.temporary();
+    Value signs = output.temporary();
+    Value quotientSign = output.temporary();
+    Value quotientFlipped = output.temporary();
+    Value fastResult = output.temporary();
+
+    //|n| = (n ^ s) - s with s = n >> 31
+    output << '\t' << sign << " = ashr i32 " << dividend << ", 31\n"
+           << '\t' << flipped << " = xor i32 " << dividend << ", " << sign << '\n'
+           << '\t' << absolute << " = sub i32 " << flipped << ", " << sign << '\n'
+           << '\t' << extended << " = zext i32 " << absolute << " to i128\n"
+           << '\t' << product << " = mul i128 " << extended << ", " << reciprocal.multiplier << '\n'
+           << '\t' << high << " = lshr i128 " << product << ", 64\n"
+           << '\t' << quotient << " = trunc i128 " << high << " to i32\n";
+
+    //The quotient is negative if the signs of n and d differ
+    output << '\t' << signs << " = xor i32 " << dividend << ", " << reciprocal.divisor << '\n'
+           << '\t' << quotientSign << " = ashr i32 " << signs << ", 31\n"
+           << '\t' << quotientFlipped << " = xor i32 " << quotient << ", " << quotientSign << '\n'
+           << '\t' << fastResult << " = sub i32 " << quotientFlipped << ", " << quotientSign << '\n'
+           << "\tbr label %" << end << "\n\n";
 
-    tempId = "%temp_var" + to_string(tempIndex);
-    tempIndex++;
+    output << slow << ":\n";
+    output.block = slow;
+
+    Value slowResult = divisionCode(output, dividend, reciprocal.divisor);
+    Label slowEnd = output.block;
+    output << "\tbr label %" << end << "\n\n";
+
+    output << end << ":\n";
+    output.block = end;
+
+    Value result = output.temporary();
+    output << '\t' << result << " = phi i32 [ " << fastResult << ", %" << fast << " ], [ " << slowResult << ", %" << slowEnd << " ]\n";
+
+    return result;
+}
+
+/**
+ * Generates the instruction of the operation on the code of its left and right handside
+ * */
+static Value operationCode(IREmitter &output, BinaryOperationNode *node, Value operand1, Value operand2)
+{
+    const char *opType;
+
+    //Divisors that do not change in the loop being generated have a reciprocal
+    if (node->operation == '/')
+    {
+        IdentifierNode *identifier = dynamic_cast<IdentifierNode *>(node->right);
+        auto found = identifier != NULL ? output.reciprocals.find(identifier->slot) : output.reciprocals.end();
+
+        if (found != output.reciprocals.end() && found->second.divisor.temporary == operand2.temporary &&
+            found->second.divisor.number == operand2.number)
+            return divideByReciprocal(output, operand1, found->second);
+
+        return divisionCode(output, operand1, operand2);
+    }
+
+    Value tempId = output.temporary();
 
     //Checks operation type
-    switch (operation)
+    switch (node->operation)
     {
     case ('+'):
         opType = "add";
@@ -270,19 +672,430 @@ string BinaryOperationNode::generateCode(ofstream &output)
     case ('-'):
         opType = "sub";
         break;
-    case ('*'):
+    default:
         opType = "mul";
         break;
-    case ('/'):
-        opType = "sdiv";
-        break;
     }
 
-    output << "\t" << tempId << " = " << opType << " i32 " << operand1 << " , " << operand2 << "\n";
+    output << '\t' << tempId << " = " << opType << " i32 " << operand1 << " , " << operand2 << '\n';
 
     return tempId;
 }
 
+/**
+ * Generates code for binary operations, generates the left and right handside first
+ * */
+Value BinaryOperationNode::generateCode(IREmitter &output)
+{
+    if (expressionDepth >= recursionLimit)
+        return generateExpression(output, this);
+
+    expressionDepth++;
+    Value operand1 = left->generateCode(output);
+    Value operand2 = right->generateCode(output);
+    expressionDepth--;
+
+    return operationCode(output, this, operand1, operand2);
+}
+
+/**
+ * Calculates the operation on the values of its left and right handside with i32 semantics
+ * */
+static int operationValue(BinaryOperationNode *node, int operand1, int operand2)
+{
+    switch (node->operation)
+    {
+    case ('+'):
+        return add(operand1, operand2);
+    case ('-'):
+        return subtract(operand1, operand2);
+    case ('*'):
+        return multiply(operand1, operand2);
+    default:
+        return divide(operand1, operand2);
+    }
+}
+
+/**
+ * Evaluates left and right handside first
+ * */
+int BinaryOperationNode::evaluate(vector<int> &variables)
+{
+    if (expressionDepth >= recursionLimit)
+        return evaluateExpression(this, variables);
+
+    expressionDepth++;
+    int operand1 = left->evaluate(variables);
+    int operand2 = right->evaluate(variables);
+    expressionDepth--;
+
+    return operationValue(this, operand1, operand2);
+}
+
+/****************
+ * ConstantDivisionNode
+ * **************/
+
+/**
+ * Calculates the constants to replace the division. If the absolute value of the divisor is 2^k
+ * the division is a shift with a rounding fixup, otherwise it is a multiplication with a magic number
+ * (Hacker's Delight, chapter 10)
+ * */
+ConstantDivisionNode::ConstantDivisionNode(ASTNode *_dividend, int _divisor)
+{
+    this->dividend = _dividend;
+    this->divisor = _divisor;
+
+    unsigned absolute = _divisor < 0 ? 0u - (unsigned)_divisor : (unsigned)_divisor;
+
+    if ((absolute & (absolute - 1)) == 0)
+    {
+        this->multiplier = 0;
+        this->shift = __builtin_ctz(absolute);
+        return;
+    }
+
+    const unsigned two31 = 0x80000000u;
+    unsigned t = two31 + ((unsigned)_divisor >> 31);
+    unsigned anc = t - 1 - t % absolute;
+    unsigned q1 = two31 / anc, r1 = two31 - q1 * anc;
+    unsigned q2 = two31 / absolute, r2 = two31 - q2 * absolute;
+    unsigned delta;
+    int p = 31;
+
+    do
+    {
+        p++;
+        q1 = 2 * q1;
+        r1 = 2 * r1;
+        if (r1 >= anc)
+        {
+            q1++;
+            r1 -= anc;
+        }
+        q2 = 2 * q2;
+        r2 = 2 * r2;
+        if (r2 >= absolute)
+        {
+            q2++;
+            r2 -= absolute;
+        }
+        delta = absolute - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+
+    this->multiplier = (int)(q2 + 1);
+    if (_divisor < 0)
+        this->multiplier = -this->multiplier;
+    this->shift = p - 32;
+}
+
+/**
+ * Generates the multiply and shift sequence for the division on the code of the dividend
+ * */
+static Value constantDivisionCode(IREmitter &output, ConstantDivisionNode *node, Value operand)
+{
+    int divisor = node->divisor, multiplier = node->multiplier, shift = node->shift;
+    Value result;
+
+    if (multiplier == 0)
+    {
+        //(n + (n < 0 ? 2^k - 1 : 0)) >> k rounds towards zero like sdiv
+        Value sign = output.temporary();
+        Value bias = output.temporary();
+        Value biased = output.temporary();
+        result = output.temporary();
+
+        output << '\t' << sign << " = ashr i32 " << operand << ", 31\n"
+               << '\t' << bias << " = lshr i32 " << sign << ", " << 32 - shift << '\n'
+               << '\t' << biased << " = add i32 " << operand << ", " << bias << '\n'
+               << '\t' << result << " = ashr i32 " << biased << ", " << shift << '\n';
+
+        if (divisor < 0)
+        {
+            Value negated = output.temporary();
+            output << '\t' << negated << " = sub i32 0, " << result << '\n';
+            result = negated;
+        }
+
+        return result;
+    }
+
+    //High half of the 64 bit product
+    Value extended = output.temporary();
+    Value product = output.temporary();
+    Value high = output.temporary();
+    result = output.temporary();
+
+    output << '\t' << extended << " = sext i32 " << operand << " to i64\n"
+           << '\t' << product << " = mul i64 " << extended << ", " << multiplier << '\n'
+           << '\t' << high << " = ashr i64 " << product << ", 32\n"
+           << '\t' << result << " = trunc i64 " << high << " to i32\n";
+
+    //The magic number did not fit in i32 with the sign of the divisor
+    if (divisor > 0 && multiplier < 0)
+    {
+        Value corrected = output.temporary();
+        output << '\t' << corrected << " = add i32 " << result << ", " << operand << '\n';
+        result = corrected;
+    }
+    else if (divisor < 0 && multiplier > 0)
+    {
+        Value corrected = output.temporary();
+        output << '\t' << corrected << " = sub i32 " << result << ", " << operand << '\n';
+        result = corrected;
+    }
+
+    if (shift > 0)
+    {
+        Value shifted = output.temporary();
+        output << '\t' << shifted << " = ashr i32 " << result << ", " << shift << '\n';
+        result = shifted;
+    }
+
+    //Adds 1 to negative quotients so they are rounded towards zero
+    Value signBit = output.temporary();
+    Value quotient = output.temporary();
+    output << '\t' << signBit << " = lshr i32 " << result << ", 31\n"
+           << '\t' << quotient << " = add i32 " << result << ", " << signBit << '\n';
+
+    return quotient;
+}
+
+Value ConstantDivisionNode::generateCode(IREmitter &output)
+{
+    if (expressionDepth >= recursionLimit)
+        return generateExpression(output, this);
+
+    expressionDepth++;
+    Value operand = dividend->generateCode(output);
+    expressionDepth--;
+
+    return constantDivisionCode(output, this, operand);
+}
+
+/**
+ * Generates the code of an expression with an explicit stack instead of recursion, so expressions
+ * nested as deep as the parser allows do not overflow the stack. The operands of operations, constant
+ * divisions and chooses are generated here in the order recursive calls would generate them, other
+ * nodes generate their own code. Shallow operations recurse, which is faster, till recursionLimit
+ * */
+static Value generateExpression(IREmitter &output, ASTNode *expression)
+{
+    //A node still to be generated with the number of its operands generated so far, and the
+    //index of its labels for a choose
+    struct Step
+    {
+        ASTNode *node;
+        int stage;
+        int index;
+    };
+
+    //The stacks are kept between calls, leaves generated on the way may generate expressions of their own above them
+    static thread_local vector<Step> steps;
+    static thread_local vector<Value> values;
+    static thread_local vector<Label> blocks;
+
+    size_t base = steps.size();
+    steps.push_back(Step{expression, 0, -1});
+
+    while (steps.size() > base)
+    {
+        Step step = steps.back();
+        steps.pop_back();
+
+        if (BinaryOperationNode *operation = dynamic_cast<BinaryOperationNode *>(step.node))
+        {
+            if (step.stage == 0)
+            {
+                steps.push_back(Step{operation, 1, -1});
+                steps.push_back(Step{operation->right, 0, -1});
+                steps.push_back(Step{operation->left, 0, -1});
+                continue;
+            }
+
+            Value operand2 = values.back();
+            values.pop_back();
+            values.back() = operationCode(output, operation, values.back(), operand2);
+        }
+        else if (ConstantDivisionNode *division = dynamic_cast<ConstantDivisionNode *>(step.node))
+        {
+            if (step.stage == 0)
+            {
+                steps.push_back(Step{division, 1, -1});
+                steps.push_back(Step{division->dividend, 0, -1});
+                continue;
+            }
+
+            values.back() = constantDivisionCode(output, division, values.back());
+        }
+        else if (ChooseNode *choose = dynamic_cast<ChooseNode *>(step.node))
+        {
+            //Every expression is generated into the block the code before it opened, its value is on
+            //top of values till the last stage replaces the four values with the value of the choose
+            ASTNode *expressions[] = {choose->expr1, choose->expr2, choose->expr3, choose->expr4};
+
+            if (step.stage == 0)
+            {
+                step.index = output.chooseIndex++;
+                blocks.resize(blocks.size() + 3);
+            }
+            else
+            {
+                Value result = chooseCode(output, step.index, step.stage, &values[values.size() - step.stage], &blocks[blocks.size() - 3]);
+
+                if (step.stage == 4)
+                {
+                    values.resize(values.size() - 3);
+                    values.back() = result;
+                    blocks.resize(blocks.size() - 3);
+                }
+            }
+
+            if (step.stage < 4)
+            {
+                steps.push_back(Step{choose, step.stage + 1, step.index});
+                steps.push_back(Step{expressions[step.stage], 0, -1});
+            }
+        }
+        else
+            values.push_back(step.node->generateCode(output));
+    }
+
+    Value value = values.back();
+    values.pop_back();
+    return value;
+}
+
+/**
+ * Divides the value with the precalculated constants of the node, gives the same result as sdiv
+ * */
+static int constantDivisionValue(ConstantDivisionNode *node, int value)
+{
+    if (node->multiplier == 0)
+    {
+        unsigned bias = (unsigned)(value >> 31) >> (32 - node->shift);
+        int quotient = (int)((unsigned)value + bias) >> node->shift;
+        return node->divisor < 0 ? (int)(0u - (unsigned)quotient) : quotient;
+    }
+
+    unsigned quotient = (unsigned)(((long long)node->multiplier * value) >> 32);
+
+    if (node->divisor > 0 && node->multiplier < 0)
+        quotient += (unsigned)value;
+    else if (node->divisor < 0 && node->multiplier > 0)
+        quotient -= (unsigned)value;
+
+    quotient = (unsigned)((int)quotient >> node->shift);
+    return (int)(quotient + (quotient >> 31));
+}
+
+int ConstantDivisionNode::evaluate(vector<int> &variables)
+{
+    if (expressionDepth >= recursionLimit)
+        return evaluateExpression(this, variables);
+
+    expressionDepth++;
+    int value = dividend->evaluate(variables);
+    expressionDepth--;
+
+    return constantDivisionValue(this, value);
+}
+
+//A node still to be evaluated by evaluateExpression() with the number of its operands evaluated so far
+struct EvaluationStep
+{
+    ASTNode *node;
+    int stage;
+};
+
+//The stacks of evaluateExpression() are kept between calls, leaves evaluated on the way may evaluate
+//expressions of their own above them
+static thread_local vector<EvaluationStep> evaluationSteps;
+static thread_local vector<int> evaluationValues;
+
+/**
+ * Evaluates an expression with an explicit stack instead of recursion like generateExpression(). The
+ * operands of operations and constant divisions are evaluated here, a choose evaluates its first
+ * expression and then only the expression it chooses, whose value becomes the value of the choose
+ * */
+static int evaluateExpression(ASTNode *expression, vector<int> &variables)
+{
+    vector<EvaluationStep> &steps = evaluationSteps;
+    vector<int> &values = evaluationValues;
+
+    size_t base = steps.size();
+    steps.push_back(EvaluationStep{expression, 0});
+
+    while (steps.size() > base)
+    {
+        EvaluationStep step = steps.back();
+        steps.pop_back();
+
+        if (BinaryOperationNode *operation = dynamic_cast<BinaryOperationNode *>(step.node))
+        {
+            if (step.stage == 0)
+            {
+                steps.push_back(EvaluationStep{operation, 1});
+                steps.push_back(EvaluationStep{operation->right, 0});
+                steps.push_back(EvaluationStep{operation->left, 0});
+                continue;
+            }
+
+            int operand2 = values.back();
+            values.pop_back();
+            values.back() = operationValue(operation, values.back(), operand2);
+        }
+        else if (ConstantDivisionNode *division = dynamic_cast<ConstantDivisionNode *>(step.node))
+        {
+            if (step.stage == 0)
+            {
+                steps.push_back(EvaluationStep{division, 1});
+                steps.push_back(EvaluationStep{division->dividend, 0});
+                continue;
+            }
+
+            values.back() = constantDivisionValue(division, values.back());
+        }
+        else if (ChooseNode *choose = dynamic_cast<ChooseNode *>(step.node))
+        {
+            if (step.stage == 0)
+            {
+                steps.push_back(EvaluationStep{choose, 1});
+                steps.push_back(EvaluationStep{choose->expr1, 0});
+                continue;
+            }
+
+            int value = values.back();
+            values.pop_back();
+            steps.push_back(EvaluationStep{value == 0 ? choose->expr2 : value > 0 ? choose->expr3 : choose->expr4, 0});
+        }
+        else
+            values.push_back(step.node->evaluate(variables));
+    }
+
+    int value = values.back();
+    values.pop_back();
+    return value;
+}
+
+/****************
+ * TrapNode
+ * **************/
+
+TrapNode::TrapNode()
+{
+}
+
+Value TrapNode::generateCode(IREmitter &output)
+{
+    return trapCode(output);
+}
+
+int TrapNode::evaluate(vector<int> &variables)
+{
+    raise(SIGFPE);
+    return 0;
+}
 
 /****************
  * PrintNode
@@ -296,11 +1109,18 @@ PrintNode::PrintNode(ASTNode *_expr)
 /**
 *  Generates print code by firstly calling code generation of expression inside print statement
 * */
-string PrintNode::generateCode(ofstream &output)
+Value PrintNode::generateCode(IREmitter &output)
 {
-    string text = expr->generateCode(output);
+    Value text = expr->generateCode(output);
     output << "\tcall i32 (i8*, ...) @printf(i8* getelementptr ([4 x i8], [4 x i8]* @print.str, i32 0, i32 0), i32 " << text << ")\n";
-    return "";
+    return Value{false, 0};
+}
+
+int PrintNode::evaluate(vector<int> &variables)
+{
+    int value = expr->evaluate(variables);
+    fprintf(programOutput != NULL ? programOutput : stdout, "%d\n", value);
+    return 0;
 }
 
 
@@ -316,47 +1136,265 @@ ConditionalNode::ConditionalNode(int _type, ASTNode *_condition)
 
 
 /**
- * Generates code for conditional statements, first generates the condition code
- * then generates the code in {} block
+ * Collects the slots of the variables assigned in the statements, in the order of their first assignment
  * */
-string ConditionalNode::generateCode(ofstream &output)
+static void assignedVariables(vector<ASTNode *> &statements, vector<int> &slots, unordered_set<int> &found)
 {
+    for (auto statement : statements)
+    {
+        if (AssignNode *assign = dynamic_cast<AssignNode *>(statement))
+        {
+            if (found.insert(assign->identifier->slot).second)
+                slots.push_back(assign->identifier->slot);
+        }
+        else if (ConditionalNode *conditional = dynamic_cast<ConditionalNode *>(statement))
+        {
+            assignedVariables(conditional->statements, slots, found);
+        }
+    }
+}
 
-    string conditionName = "cond_" + to_string(conditionalIndex);
-    conditionalIndex++;
+/**
+ * Collects the slots of the variables that divide something in the node and are not assigned in the loop
+ * */
+static void invariantDivisors(ASTNode *node, unordered_set<int> &assigned, vector<int> &slots)
+{
+    //Nodes still to be looked at, the next one on top. Children are pushed in reverse so they are
+    //visited in the order they are written
+    vector<ASTNode *> pending(1, node);
+
+    while (!pending.empty())
+    {
+        node = pending.back();
+        pending.pop_back();
+
+        if (BinaryOperationNode *operation = dynamic_cast<BinaryOperationNode *>(node))
+        {
+            IdentifierNode *identifier = dynamic_cast<IdentifierNode *>(operation->right);
+
+            if (operation->operation == '/' && identifier != NULL && assigned.count(identifier->slot) == 0 &&
+                find(slots.begin(), slots.end(), identifier->slot) == slots.end())
+                slots.push_back(identifier->slot);
+
+            pending.push_back(operation->right);
+            pending.push_back(operation->left);
+        }
+        else if (ChooseNode *choose = dynamic_cast<ChooseNode *>(node))
+        {
+            pending.push_back(choose->expr4);
+            pending.push_back(choose->expr3);
+            pending.push_back(choose->expr2);
+            pending.push_back(choose->expr1);
+        }
+        else if (ConstantDivisionNode *division = dynamic_cast<ConstantDivisionNode *>(node))
+            pending.push_back(division->dividend);
+        else if (PrintNode *print = dynamic_cast<PrintNode *>(node))
+            pending.push_back(print->expr);
+        else if (AssignNode *assign = dynamic_cast<AssignNode *>(node))
+            pending.push_back(assign->expr);
+        else if (ConditionalNode *conditional = dynamic_cast<ConditionalNode *>(node))
+        {
+            pending.insert(pending.end(), conditional->statements.rbegin(), conditional->statements.rend());
+            pending.push_back(conditional->condition);
+        }
+    }
+}
+
+/**
+ * Calculates the reciprocal of the divisor in the current block. The udiv does not trap, divisors
+ * 0, 1 and -1 are replaced by 2 and marked unusable
+ * */
+static Reciprocal reciprocal(IREmitter &output, Value divisor)
+{
+    Reciprocal result;
+    result.divisor = divisor;
+
+    Value sign = output.temporary();
+    Value flipped = output.temporary();
+    Value absolute = output.temporary();
+    Value extended = output.temporary();
+    Value safe = output.temporary();
+    Value quotient = output.temporary();
+    Value rounded = output.temporary();
+
+    result.usable = output.temporary();
+    result.multiplier = output.temporary();
+
+    //ceil(2^64 / d) = floor((2^64 - 1) / d) + 1 for d >= 2
+    output << '\t' << sign << " = ashr i32 " << divisor << ", 31\n"
+           << '\t' << flipped << " = xor i32 " << divisor << ", " << sign << '\n'
+           << '\t' << absolute << " = sub i32 " << flipped << ", " << sign << '\n'
+           << '\t' << result.usable << " = icmp ugt i32 " << absolute << ", 1\n"
+           << '\t' << extended << " = zext i32 " << absolute << " to i64\n"
+           << '\t' << safe << " = select i1 " << result.usable << ", i64 " << extended << ", i64 2\n"
+           << '\t' << quotient << " = udiv i64 -1, " << safe << '\n'
+           << '\t' << rounded << " = add i64 " << quotient << ", 1\n"
+           << '\t' << result.multiplier << " = zext i64 " << rounded << " to i128\n";
+
+    return result;
+}
 
-    output << "\tbr label %" << conditionName << "entry\n\n";
-    output << conditionName << "entry:\n";
+/**
+ * Generates code for conditional statements, first generates the condition code
+ * then generates the code in {} block. Variables assigned in the block get phi nodes
+ * at cond_Nend for if and at cond_Nentry for while
+ * */
+Value ConditionalNode::generateCode(IREmitter &output)
+{
+    int index = output.conditionalIndex;
+    output.conditionalIndex++;
+
+    Label entry = {"cond", index, "entry"};
+    Label body = {"cond", index, "body"};
+    Label end = {"cond", index, "end"};
 
-    string id = condition->generateCode(output); //Generates condition code
-    string tempVar = "%temp_var" + to_string(tempIndex);
-    tempIndex++;
+    vector<int> assigned;
+    unordered_set<int> found;
+    assignedVariables(statements, assigned, found);
 
-    output << "\t" << tempVar << " = icmp ne i32 " << id << ", 0\n";
-    output << "\tbr i1 " << tempVar << ", label %" << conditionName << "body, label %" << conditionName << "end\n\n";
+    //Divisors that stay the same in a while loop get their reciprocal in front of it
+    vector<int> divisors, reciprocals;
 
-    output << conditionName << "body:\n";
+    if (this->type != 0)
+        invariantDivisors(this, found, divisors);
 
-    //Generates code for the statements inside conditional
-    for (auto expression : statements)
+    for (int slot : divisors)
     {
-        expression->generateCode(output);
+        Value value = output.values[slot];
+
+        //Constant divisors are left to LLVM, outer loops may have the reciprocal already
+        if (!value.temporary || output.reciprocals.count(slot) != 0)
+            continue;
+
+        output.reciprocals[slot] = reciprocal(output, value);
+        reciprocals.push_back(slot);
     }
 
-    //checks type op conditional and adjusts the code for it
+    output << "\tbr label %" << entry << "\n\n";
+
     if (this->type == 0)
     {
-        output << "\tbr label %" << conditionName << "end\n\n";
+        output << entry << ":\n";
+        output.block = entry;
+
+        Value id = condition->generateCode(output); //Generates condition code
+        Value tempVar = output.temporary();
+
+        output << '\t' << tempVar << " = icmp ne i32 " << id << ", 0\n";
+        output << "\tbr i1 " << tempVar << ", label %" << body << ", label %" << end << "\n\n";
+
+        //Values the variables have when the body is skipped
+        Label skipBlock = output.block;
+        vector<Value> skipValues;
+        for (int slot : assigned)
+            skipValues.push_back(output.values[slot]);
+
+        output << body << ":\n";
+        output.block = body;
+
+        //Generates code for the statements inside conditional
+        for (auto expression : statements)
+        {
+            expression->generateCode(output);
+        }
+
+        output << "\tbr label %" << end << "\n\n";
+        output << end << ":\n";
+
+        for (size_t i = 0; i < assigned.size(); i++)
+        {
+            Value &value = output.values[assigned[i]];
+
+            if (value.temporary == skipValues[i].temporary && value.number == skipValues[i].number)
+                continue;
+
+            Value phi = output.temporary();
+            output << '\t' << phi << " = phi i32 [ " << skipValues[i] << ", %" << skipBlock << " ], [ " << value << ", %" << output.block << " ]\n";
+            value = phi;
+        }
     }
     else
     {
-        output << "\tbr label %" << conditionName << "entry\n\n";
+        //Every assigned variable gets a phi in the loop header. Their values coming from the end of
+        //the body are not known yet, so the phis are written after the loop and moved in front of it
+        Label preheader = output.block;
+        vector<Value> initialValues, phis;
+
+        for (int slot : assigned)
+        {
+            initialValues.push_back(output.values[slot]);
+            phis.push_back(output.temporary());
+            output.values[slot] = phis.back();
+        }
+
+        output << entry << ":\n";
+        size_t loopStart = output.mark();
+        output.block = entry;
+
+        Value id = condition->generateCode(output); //Generates condition code
+        Value tempVar = output.temporary();
+
+        output << '\t' << tempVar << " = icmp ne i32 " << id << ", 0\n";
+        output << "\tbr i1 " << tempVar << ", label %" << body << ", label %" << end << "\n\n";
+
+        output << body << ":\n";
+        output.block = body;
+
+        //Generates code for the statements inside conditional
+        for (auto expression : statements)
+        {
+            expression->generateCode(output);
+        }
+
+        output << "\tbr label %" << entry << "\n\n";
+
+        size_t phiStart = output.mark();
+
+        for (size_t i = 0; i < assigned.size(); i++)
+        {
+            output << '\t' << phis[i] << " = phi i32 [ " << initialValues[i] << ", %" << preheader << " ], [ "
+                   << output.values[assigned[i]] << ", %" << output.block << " ]\n";
+
+            //After the loop the variables have the values of the last condition check
+            output.values[assigned[i]] = phis[i];
+        }
+
+        output.moveTo(loopStart, phiStart);
+
+        output << end << ":\n";
+
+        for (int slot : reciprocals)
+            output.reciprocals.erase(slot);
     }
 
-    output << conditionName << "end:\n";
-    tempIndex++;
+    output.block = end;
 
-    return "";
+    return Value{false, 0};
+}
+
+/**
+ * Runs the statements in {} block once for if and as long as the condition is not 0 for while
+ * */
+int ConditionalNode::evaluate(vector<int> &variables)
+{
+    if (this->type == 0)
+    {
+        if (condition->evaluate(variables) != 0)
+        {
+            for (auto expression : statements)
+                expression->evaluate(variables);
+        }
+    }
+    else
+    {
+        while (condition->evaluate(variables) != 0)
+        {
+            for (auto expression : statements)
+                expression->evaluate(variables);
+        }
+    }
+
+    return 0;
 }
 
 
@@ -371,12 +1409,85 @@ AssignNode::AssignNode(IdentifierNode *id, ASTNode *expr)
 }
 
 /**
- * Code generation for assignment statements
+ * Code generation for assignment statements. The variable takes the SSA value of the expression,
+ * there is no store
+ * */
+Value AssignNode::generateCode(IREmitter &output)
+{
+    output.values[identifier->slot] = expr->generateCode(output);
+    return Value{false, 0};
+}
+
+int AssignNode::evaluate(vector<int> &variables)
+{
+    int value = expr->evaluate(variables);
+    variables[identifier->slot] = value;
+    return 0;
+}
+
+/****************
+ * Code generation entry points
+ * **************/
+
+/**
+ * Creates the code for syntax error in given line
  * */
-string AssignNode::generateCode(ofstream &output)
+void syntaxError(int line, ostream &output)
 {
-    string value = expr->generateCode(output);
-    string id = identifier->getID();
-    output << "\tstore i32 " << value << ", i32* %" << id << "\n";
-    return "";
+    output << "; ModuleID = \'division-interpreter\'\n"
+           << "declare i32 @printf(i8*, ...)\n"
+           << "@print.str = constant [23 x i8] c\"Line %d: syntax error\\0A\\00\"\n\n"
+           << "define i32 @main() {\n"
+           << "\tcall i32 (i8*, ...) @printf(i8* getelementptr ([23 x i8], [23 x i8]* @print.str, i32 0, i32 0), i32 " << line << ")\n"
+           << "\tret i32 0\n"
+           << "}";
+}
+
+/**
+ * Writes the start of the module and of the main function, the code of the statements follows it
+ * */
+void generateHeader(IREmitter &output)
+{
+    output << "; ModuleID = \'division-interpreter\'\n"
+           << "declare i32 @printf(i8*, ...)\n"
+           << "@print.str = constant [4 x i8] c\"%d\\0A\\00\"\n"
+           << "@division.zero = global i32 0\n\n"
+           << "define i32 @main() {\n"
+           << "entry:\n";
+}
+
+/**
+ * Finishes the main function after the code of the last statement
+ * */
+void generateFooter(IREmitter &output)
+{
+    output << "\tret i32 0\n"
+           << "}";
+}
+
+/**
+ * Generates IR code by adding headers to file and running generateCode() function from AST nodes
+ * which creates IR code for its type.
+ * Takes parameters ofstream output to print to file, vector<ASTNode> program is the AST
+ * and varmap stores all the declared variables, which start as 0.
+ * */
+void generateIR(ostream &file, vector<ASTNode *> &program, vector<string> &varmap)
+{
+    IREmitter output(file);
+
+    //Adding header to .ll file
+    generateHeader(output);
+
+    //Variables are SSA values, they all start as 0
+    output.values.assign(varmap.size(), Value{false, 0});
+
+    //Creates the code from given program, the code is written to the file in large blocks
+    for (auto expression : program)
+    {
+        expression->generateCode(output);
+        output.flushIfFull();
+    }
+
+    //Finishes the code creation
+    generateFooter(output);
 }
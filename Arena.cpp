@@ -0,0 +1,149 @@
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+using namespace std;
+
+/**
+ * Memory for everything created during one compilation: AST nodes and their strings.
+ * Memory is handed out from large blocks and released all at once by reset() or the destructor,
+ * objects that need a destructor call (like the statement vector of ConditionalNode) are
+ * remembered and destroyed at that point.
+ * */
+class Arena
+{
+public:
+    struct Cleanup
+    {
+        void (*destroy)(void *object);
+        void *object;
+        Cleanup *next;
+    };
+
+    vector<pair<char *, size_t>> blocks;
+    char *position; //free part of the current block
+    char *limit;
+    size_t blockSize;
+    Cleanup *cleanups;
+
+    size_t allocations;
+    size_t bytesAllocated; //bytes handed out since the last reset
+    size_t peakBytes;      //largest value of bytesAllocated
+    size_t bytesReserved;  //size of all blocks
+
+    Arena(size_t _blockSize = 1 << 16);
+    ~Arena();
+
+    void *allocate(size_t size, size_t alignment = alignof(void *));
+    const char *copyString(const string &text);
+    void reset();
+
+    /**
+     * Creates an object in the arena
+     * */
+    template <typename T, typename... Args>
+    T *make(Args &&... args)
+    {
+        T *object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+
+        if (!is_trivially_destructible<T>::value)
+        {
+            Cleanup *cleanup = (Cleanup *)allocate(sizeof(Cleanup), alignof(Cleanup));
+            cleanup->destroy = [](void *object) { ((T *)object)->~T(); };
+            cleanup->object = object;
+            cleanup->next = cleanups;
+            cleanups = cleanup;
+        }
+
+        return object;
+    }
+};
+
+Arena::Arena(size_t _blockSize)
+{
+    this->blockSize = _blockSize;
+    this->position = NULL;
+    this->limit = NULL;
+    this->cleanups = NULL;
+    this->allocations = 0;
+    this->bytesAllocated = 0;
+    this->peakBytes = 0;
+    this->bytesReserved = 0;
+}
+
+Arena::~Arena()
+{
+    reset();
+
+    for (auto block : blocks)
+        free(block.first);
+}
+
+/**
+ * Returns size bytes with the given alignment. A new block is started when the current one is full,
+ * allocations larger than the block size get a block of their own.
+ * */
+void *Arena::allocate(size_t size, size_t alignment)
+{
+    char *start = position == NULL ? NULL : (char *)(((uintptr_t)position + alignment - 1) & ~(uintptr_t)(alignment - 1));
+
+    if (start == NULL || start + size > limit)
+    {
+        size_t capacity = size + alignment > blockSize ? size + alignment : blockSize;
+        char *block = (char *)malloc(capacity);
+
+        blocks.push_back(make_pair(block, capacity));
+        bytesReserved += capacity;
+
+        position = block;
+        limit = block + capacity;
+        start = (char *)(((uintptr_t)position + alignment - 1) & ~(uintptr_t)(alignment - 1));
+    }
+
+    bytesAllocated += start + size - position;
+    if (bytesAllocated > peakBytes)
+        peakBytes = bytesAllocated;
+    allocations++;
+
+    position = start + size;
+    return start;
+}
+
+/**
+ * Copies the string into the arena, the copy is null terminated
+ * */
+const char *Arena::copyString(const string &text)
+{
+    char *copy = (char *)allocate(text.size() + 1, 1);
+    memcpy(copy, text.c_str(), text.size() + 1);
+    return copy;
+}
+
+/**
+ * Destroys all objects and makes the memory available again. The first block is kept for the next
+ * compilation, the others are freed.
+ * */
+void Arena::reset()
+{
+    for (Cleanup *cleanup = cleanups; cleanup != NULL; cleanup = cleanup->next)
+        cleanup->destroy(cleanup->object);
+    cleanups = NULL;
+
+    for (size_t i = 1; i < blocks.size(); i++)
+    {
+        bytesReserved -= blocks[i].second;
+        free(blocks[i].first);
+    }
+
+    if (blocks.size() > 1)
+        blocks.resize(1);
+
+    position = blocks.empty() ? NULL : blocks[0].first;
+    limit = blocks.empty() ? NULL : blocks[0].first + blocks[0].second;
+    bytesAllocated = 0;
+}
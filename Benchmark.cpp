@@ -0,0 +1,713 @@
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <type_traits>
+#include <utility>
+#include <new>
+#include <fstream>
+#include <iostream>
+#include <ostream>
+#include <streambuf>
+#include <chrono>
+#include <iomanip>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace std;
+
+class BytecodeCompiler;
+class Columns;
+class Arena;
+
+/**
+ * Result of the code generation of an expression: an integer constant or the number of a temporary
+ * */
+struct Value
+{
+    bool temporary;
+    int number;
+};
+
+/**
+ * Name of a basic block, written as <kind>_<index><part> like cond_3body.
+ * Labels with a negative index are written as <kind> only
+ * */
+struct Label
+{
+    const char *kind;
+    int index;
+    const char *part;
+};
+
+class IREmitter;
+
+// Abstract class for Asynchronous Syntax Tree
+
+class ASTNode
+{
+public:
+    virtual Value generateCode(IREmitter &output) = 0;
+    virtual int evaluate(vector<int> &variables) = 0;
+    virtual int compile(BytecodeCompiler &compiler, int target) = 0;
+    virtual ASTNode *fold(Arena &arena) = 0;
+    virtual const int *evaluateColumns(Columns &columns, const int *mask) = 0;
+ };
+
+/**
+ * Stores identifier of variables. Can generate code with temp variables
+ * */
+class IdentifierNode : public ASTNode
+{
+public:
+    const char *name;
+    int slot; //index of the variable in Parser::variables and in the variables of every backend
+    IdentifierNode(const char *_name, int _slot);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+    string getID();
+};
+
+
+/**
+ * Stores values for numbers. generateCode() function returns the integer value
+ * */
+class NumberNode : public ASTNode
+{
+public:
+    int value;
+    NumberNode(int _value);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node for choose expression, stores the expressions inside parantheses. 
+ * Generates code for both expressions and choose function.
+ * */
+class ChooseNode : public ASTNode
+{
+public:
+    ASTNode *expr1, *expr2, *expr3, *expr4;
+    ChooseNode(ASTNode *_expr1, ASTNode *_expr2, ASTNode *_expr3, ASTNode *_expr4);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node for binary operations. Stores the operation type, right and left handside as expressions
+ * and generates code for the calculation
+ * */
+class BinaryOperationNode : public ASTNode
+{
+public:
+    ASTNode *left;
+    ASTNode *right;
+    char operation;
+
+    BinaryOperationNode(ASTNode *_left, ASTNode *_right, char _operation);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node for division by a constant divisor, fold() creates it from BinaryOperationNode.
+ * The division is calculated with a multiplication and shifts instead of a division instruction
+ * */
+class ConstantDivisionNode : public ASTNode
+{
+public:
+    ASTNode *dividend;
+    int divisor;    //anything but 0, 1 and -1
+    int multiplier; //0 if the absolute value of divisor is a power of two
+    int shift;
+
+    ConstantDivisionNode(ASTNode *_dividend, int _divisor);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node for a division that always traps, by zero or INT_MIN / -1. fold() creates it from
+ * BinaryOperationNode, the operands are dropped since the division traps whatever they calculate
+ * */
+class TrapNode : public ASTNode
+{
+public:
+    TrapNode();
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node for print statements. Generates code for print statement and expression inside the statement
+ * */
+class PrintNode : public ASTNode
+{
+public:
+    ASTNode *expr;
+    PrintNode(ASTNode *_expr);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node to store conditional statements. Stores the condition, conditional type and statements
+ * inside the code block and generates code for all of them
+ * */
+class ConditionalNode : public ASTNode
+{
+public:
+    int type;
+    ASTNode *condition;
+    vector<ASTNode *> statements;
+
+    ConditionalNode(int _type, ASTNode *_condition);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node for assignment statement. Stores identifier and expression 
+ * Generates code for assignment statement
+ * */
+class AssignNode : public ASTNode
+{
+public:
+    IdentifierNode *identifier;
+    ASTNode *expr;
+    AssignNode(IdentifierNode *id, ASTNode *expr);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Memory for everything created during one compilation: AST nodes and their strings.
+ * Memory is handed out from large blocks and released all at once by reset() or the destructor,
+ * objects that need a destructor call (like the statement vector of ConditionalNode) are
+ * remembered and destroyed at that point.
+ * */
+class Arena
+{
+public:
+    struct Cleanup
+    {
+        void (*destroy)(void *object);
+        void *object;
+        Cleanup *next;
+    };
+
+    vector<pair<char *, size_t>> blocks;
+    char *position; //free part of the current block
+    char *limit;
+    size_t blockSize;
+    Cleanup *cleanups;
+
+    size_t allocations;
+    size_t bytesAllocated; //bytes handed out since the last reset
+    size_t peakBytes;      //largest value of bytesAllocated
+    size_t bytesReserved;  //size of all blocks
+
+    Arena(size_t _blockSize = 1 << 16);
+    ~Arena();
+
+    void *allocate(size_t size, size_t alignment = alignof(void *));
+    const char *copyString(const string &text);
+    void reset();
+
+    /**
+     * Creates an object in the arena
+     * */
+    template <typename T, typename... Args>
+    T *make(Args &&... args)
+    {
+        T *object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+
+        if (!is_trivially_destructible<T>::value)
+        {
+            Cleanup *cleanup = (Cleanup *)allocate(sizeof(Cleanup), alignof(Cleanup));
+            cleanup->destroy = [](void *object) { ((T *)object)->~T(); };
+            cleanup->object = object;
+            cleanup->next = cleanups;
+            cleanups = cleanup;
+        }
+
+        return object;
+    }
+};
+
+enum TokenType
+{
+    token_identifier,
+    token_number,
+    token_operator,
+    token_print,
+    token_choose,
+    token_conditional,
+    token_eol,
+    token_eof
+};
+
+/**
+ * Operator tokens, the value of each operator is its character
+ * */
+enum OperatorType : char
+{
+    operator_plus = '+',
+    operator_minus = '-',
+    operator_multiply = '*',
+    operator_divide = '/',
+    operator_assign = '=',
+    operator_comma = ',',
+    operator_open_paren = '(',
+    operator_close_paren = ')',
+    operator_open_brace = '{',
+    operator_close_brace = '}'
+};
+
+struct Token
+{
+    TokenType type;
+    int line;
+    union
+    {
+        OperatorType op; //token_operator, any other character is stored as it is
+        int symbol;      //token_identifier, index of the name in the symbol table
+        int number;      //token_number, value of the literal truncated to i32
+        int conditional; //token_conditional, 0 for if and 1 for while
+    };
+};
+
+/**
+ * Interns identifiers. Every distinct name gets the next symbol index and is stored once in the arena,
+ * the hash table is looked up with the characters in the input buffer so no string is created.
+ * */
+class SymbolTable
+{
+public:
+    Arena *arena;
+    vector<const char *> names;
+    vector<unsigned> hashes;
+    vector<int> lengths;
+    vector<int> table; //open addressing, holds symbol indexes or -1
+
+    SymbolTable(Arena *_arena);
+
+    int intern(const char *text, int length);
+};
+
+class Tokenizer
+{
+public:
+    const char *cursor; //next character to read
+    const char *end;
+    bool eof;           //set when a character is read past the end of the input
+    char lastChar;
+    int line;
+
+    SymbolTable symbols;
+
+    Tokenizer(const char *input, size_t size, Arena *arena);
+
+    void nextChar();
+    Token getNextToken();
+};
+
+
+class Parser
+{
+public:
+    Tokenizer *tokenizer;
+    Arena *arena; //owns all nodes created by the parser
+    int line, errLine;
+    bool error;
+    vector<string> variables; //declared variables in the order they first appear, their index is their slot
+    vector<int> slots;        //slot of every symbol, -1 for symbols that are not declared yet
+    Token currentToken, lastToken;
+
+    Parser(Tokenizer *_tokenizer, Arena *_arena);
+
+    ASTNode *parseParanExpr();
+    ASTNode *parsePrint();
+    ASTNode *parseExpr();
+    ASTNode *parseStatement();
+    ASTNode *parse();
+
+    void syntaxError(int line);
+    Token getToken();
+    bool isOperator(OperatorType op);
+    int declare(int symbol);
+};
+
+void generateIR(ostream &file, vector<ASTNode *> &program, vector<string> &varmap);
+
+/****************
+ * Program generators
+ *
+ * Every generator writes a program of about the same size in bytes at scale 1, each one stresses
+ * another part of the compiler.
+ * **************/
+
+/**
+ * Straight line assignments over 1000 variables, like v17 = v119 * 18 / (v221 * 4)
+ * */
+static string assignments(int count)
+{
+    string program;
+    char line[96];
+
+    for (int i = 1; i <= count; i++)
+    {
+        snprintf(line, sizeof(line), "v%d = v%d * %d / (v%d * %d)\n", i % 1000, i * 7 % 1000, i % 97 + 1, i * 13 % 1000, i % 13 + 2);
+        program += line;
+    }
+
+    return program + "print(v1)\n";
+}
+
+/**
+ * Operations nested depth parentheses deep, x = ((((y * 3) / 5) * 3) / 5 ...)
+ * */
+static string parentheses(int depth, int count)
+{
+    string program;
+    string line = "x = " + string(depth, '(') + "y";
+
+    for (int i = 0; i < depth; i++)
+        line += i % 2 == 0 ? " * 3)" : " / 5)";
+
+    line += "\n";
+
+    for (int i = 0; i < count; i++)
+        program += line;
+
+    return program + "print(x)\n";
+}
+
+/**
+ * choose() nested length times in its last branch, x = choose(a1, 1, 2, choose(a2, 3, 4, ...))
+ * */
+static string chooseChains(int length, int count)
+{
+    string program;
+    string line = "x = ";
+    char branch[64];
+
+    for (int i = 0; i < length; i++)
+    {
+        snprintf(branch, sizeof(branch), "choose(a%d, %d, x / %d, ", i % 50, i, i + 2);
+        line += branch;
+    }
+
+    line += "x" + string(length, ')') + "\n";
+
+    for (int i = 0; i < count; i++)
+        program += line;
+
+    return program + "print(x)\n";
+}
+
+/**
+ * Alternating if and while blocks of width statements each. Blocks can not be nested in this
+ * language, so the programs are wide instead of deep
+ * */
+static string conditionals(int width, int count)
+{
+    string program;
+    char line[96];
+
+    for (int i = 0; i < count; i++)
+    {
+        snprintf(line, sizeof(line), i % 2 == 0 ? "if (c%d / 3) {\n" : "while (c%d) {\n", i % 100);
+        program += line;
+
+        for (int j = 0; j < width; j++)
+        {
+            snprintf(line, sizeof(line), "  v%d = v%d * %d / (c%d * 3)\n", j % 100, (i + j) % 100, j + 2, j % 100);
+            program += line;
+        }
+
+        if (i % 2 != 0)
+        {
+            snprintf(line, sizeof(line), "  c%d = c%d / 2\n", i % 100, i % 100);
+            program += line;
+        }
+
+        program += "}\n";
+    }
+
+    return program + "print(v1)\n";
+}
+
+/****************
+ * Measurements
+ * **************/
+
+/**
+ * Output stream buffer that only counts the bytes written to it, so IR generation is timed
+ * without the cost of storing the code
+ * */
+class CountingBuffer : public streambuf
+{
+public:
+    size_t bytes = 0;
+
+protected:
+    streamsize xsputn(const char *data, streamsize count)
+    {
+        bytes += count;
+        return count;
+    }
+
+    int overflow(int character)
+    {
+        bytes++;
+        return character;
+    }
+};
+
+struct Measurement
+{
+    string generator;
+    string phase;
+    double rate; //units per second
+    const char *unit;
+};
+
+static double elapsedSeconds(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Counts the nodes of the tree
+ * */
+static size_t countNodes(ASTNode *node)
+{
+    if (BinaryOperationNode *operation = dynamic_cast<BinaryOperationNode *>(node))
+        return 1 + countNodes(operation->left) + countNodes(operation->right);
+    if (ChooseNode *choose = dynamic_cast<ChooseNode *>(node))
+        return 1 + countNodes(choose->expr1) + countNodes(choose->expr2) + countNodes(choose->expr3) + countNodes(choose->expr4);
+    if (ConstantDivisionNode *division = dynamic_cast<ConstantDivisionNode *>(node))
+        return 1 + countNodes(division->dividend);
+    if (PrintNode *print = dynamic_cast<PrintNode *>(node))
+        return 1 + countNodes(print->expr);
+    if (AssignNode *assign = dynamic_cast<AssignNode *>(node))
+        return 1 + countNodes(assign->identifier) + countNodes(assign->expr);
+
+    if (ConditionalNode *conditional = dynamic_cast<ConditionalNode *>(node))
+    {
+        size_t count = 1 + countNodes(conditional->condition);
+
+        for (auto statement : conditional->statements)
+            count += countNodes(statement);
+
+        return count;
+    }
+
+    return 1;
+}
+
+/**
+ * Times the three phases on the program, every phase is run repeat times and the best run counts.
+ * Tokenizing runs Tokenizer::getNextToken() alone, parsing runs Parser::parse() which tokenizes
+ * as it goes, IR generation runs generateIR() on the parsed program
+ * */
+static void measure(const string &generator, const string &source, int repeat, vector<Measurement> &results)
+{
+    double tokenRate = 0, nodeRate = 0, byteRate = 0;
+
+    for (int run = 0; run < repeat; run++)
+    {
+        //Tokenizing
+        auto start = chrono::steady_clock::now();
+        size_t tokens = 0;
+        {
+            Arena arena;
+            Tokenizer tokenizer(source.data(), source.size(), &arena);
+
+            while (tokenizer.getNextToken().type != token_eof)
+                tokens++;
+        }
+        tokenRate = max(tokenRate, tokens / elapsedSeconds(start));
+
+        //Parsing
+        start = chrono::steady_clock::now();
+        Arena arena;
+        Tokenizer tokenizer(source.data(), source.size(), &arena);
+        Parser parser(&tokenizer, &arena);
+        vector<ASTNode *> program;
+
+        while (!parser.error && parser.currentToken.type != token_eof)
+        {
+            ASTNode *node = parser.parse();
+
+            if (node == NULL)
+                break;
+
+            program.push_back(node);
+        }
+
+        double parseTime = elapsedSeconds(start);
+
+        if (parser.error)
+        {
+            cerr << "division-benchmark: " << generator << ": syntax error in line " << parser.errLine << "\n";
+            exit(1);
+        }
+
+        size_t nodes = 0;
+
+        for (auto statement : program)
+            nodes += countNodes(statement);
+
+        nodeRate = max(nodeRate, nodes / parseTime);
+
+        //IR generation
+        start = chrono::steady_clock::now();
+        CountingBuffer counter;
+        ostream output(&counter);
+        generateIR(output, program, parser.variables);
+        byteRate = max(byteRate, counter.bytes / elapsedSeconds(start));
+    }
+
+    results.push_back({generator, "tokenize", tokenRate, "tokens/s"});
+    results.push_back({generator, "parse", nodeRate, "nodes/s"});
+    results.push_back({generator, "generateIR", byteRate, "bytes/s"});
+}
+
+/**
+ * Reads a baseline written by --save, lines of generator, phase and rate
+ * */
+static bool loadBaseline(const string &fileName, unordered_map<string, double> &baseline)
+{
+    ifstream file(fileName);
+
+    if (!file)
+        return false;
+
+    string generator, phase;
+    double rate;
+
+    while (file >> generator >> phase >> rate)
+        baseline[generator + " " + phase] = rate;
+
+    return true;
+}
+
+/**
+ * Generates the programs, times every compiler phase on them and prints the rates. With --baseline
+ * the rates are compared against a saved run, phases that got slower than the tolerance are marked
+ * and make the exit status 1. --save writes the rates as the new baseline.
+ * */
+int main(int argc, char *argv[])
+{
+    double scale = 1;
+    int repeat = 3;
+    double tolerance = 10; //percent
+    string baselineFile, saveFile;
+
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+
+        if (arg.compare(0, 8, "--scale=") == 0)
+            scale = atof(arg.c_str() + 8);
+        else if (arg.compare(0, 9, "--repeat=") == 0)
+            repeat = max(atoi(arg.c_str() + 9), 1);
+        else if (arg.compare(0, 12, "--tolerance=") == 0)
+            tolerance = atof(arg.c_str() + 12);
+        else if (arg.compare(0, 11, "--baseline=") == 0)
+            baselineFile = arg.substr(11);
+        else if (arg.compare(0, 7, "--save=") == 0)
+            saveFile = arg.substr(7);
+        else
+        {
+            cerr << "usage: " << argv[0] << " [--scale=F] [--repeat=N] [--baseline=FILE [--tolerance=PERCENT]] [--save=FILE]\n";
+            return 1;
+        }
+    }
+
+    auto scaled = [scale](int count) { return max((int)(count * scale), 1); };
+
+    vector<pair<string, string>> programs = {
+        {"assignments", assignments(scaled(1000000))},
+        {"parentheses", parentheses(1000, scaled(5000))},
+        {"choose", chooseChains(100, scaled(10000))},
+        {"conditionals", conditionals(100, scaled(10000))},
+    };
+
+    unordered_map<string, double> baseline;
+
+    if (baselineFile != "" && !loadBaseline(baselineFile, baseline))
+        cerr << "division-benchmark: no baseline in " << baselineFile << " to compare with, make bench-baseline stores one\n";
+
+    vector<Measurement> results;
+    bool slower = false;
+
+    printf("%-13s %-11s %-18s %9s %9s\n", "program", "phase", "rate", "baseline", "change");
+
+    for (auto &program : programs)
+    {
+        size_t first = results.size();
+        measure(program.first, program.second, repeat, results);
+
+        for (size_t i = first; i < results.size(); i++)
+        {
+            Measurement &result = results[i];
+            printf("%-13s %-11s %8.2fM %-8s", result.generator.c_str(), result.phase.c_str(), result.rate / 1e6, result.unit);
+
+            auto found = baseline.find(result.generator + " " + result.phase);
+
+            if (found != baseline.end())
+            {
+                double change = (result.rate / found->second - 1) * 100;
+                printf(" %8.2fM %+8.1f%%%s", found->second / 1e6, change, change < -tolerance ? "  slower" : "");
+                slower = slower || change < -tolerance;
+            }
+
+            printf("\n");
+            fflush(stdout);
+        }
+
+        //The program is not needed anymore, its memory is given back before the next one is generated
+        string().swap(program.second);
+    }
+
+    if (saveFile != "")
+    {
+        ofstream file(saveFile);
+
+        for (auto &result : results)
+            file << result.generator << " " << result.phase << " " << fixed << setprecision(0) << result.rate << "\n";
+    }
+
+    return slower ? 1 : 0;
+}
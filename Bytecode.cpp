@@ -0,0 +1,1127 @@
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <cstdio>
+#include <climits>
+#include <csignal>
+#include <cstring>
+
+using namespace std;
+
+/**
+ * Instructions of the bytecode. Operands are register indexes, jumps store the index of the
+ * instruction to continue with.
+ * */
+enum Opcode
+{
+    op_move,        // a = b
+    op_add,         // a = b + c
+    op_sub,         // a = b - c
+    op_mul,         // a = b * c
+    op_div,         // a = b / c
+    op_div_magic,   // a = b / divisors[c], with a multiplication
+    op_div_pow2,    // a = b / divisors[c], with shifts
+    op_jump,        // goto a
+    op_jump_zero,   // if a == 0 goto b
+    op_jump_nonzero,// if a != 0 goto b
+    op_jump_less,   // if a < 0 goto b
+    op_print,       // print a
+    op_halt
+};
+
+struct Instruction
+{
+    int opcode;
+    int a, b, c;
+};
+
+/**
+ * Constants of a ConstantDivisionNode
+ * */
+struct Divisor
+{
+    int divisor, multiplier, shift;
+};
+
+/**
+ * Compiled program. Registers are laid out as variables, temporaries and constants,
+ * constants are written into their registers before the program starts.
+ * */
+class Bytecode
+{
+public:
+    vector<Instruction> code;
+    vector<string> variables;
+    vector<int> constants;
+    vector<Divisor> divisors;
+    int temporaries;
+
+    int registerCount();
+    string registerName(int index);
+};
+
+/**
+ * Compiles the AST into bytecode. Temporaries are allocated like a stack, each expression
+ * releases the temporaries of its operands after using them.
+ * */
+class BytecodeCompiler
+{
+public:
+    Bytecode *bytecode;
+    unordered_map<int, int> constantIndexes;
+    int nextTemporary;
+
+    BytecodeCompiler(Bytecode *_bytecode, vector<string> &variables);
+
+    int variable(int slot);
+    int constant(int value);
+    int temporary();
+    int emit(int opcode, int a, int b = 0, int c = 0);
+    void patch(int index, int target);
+    void finish();
+};
+
+class Arena;
+class Columns;
+
+/**
+ * Result of the code generation of an expression: an integer constant or the number of a temporary
+ * */
+struct Value
+{
+    bool temporary;
+    int number;
+};
+
+/**
+ * Name of a basic block, written as <kind>_<index><part> like cond_3body.
+ * Labels with a negative index are written as <kind> only
+ * */
+struct Label
+{
+    const char *kind;
+    int index;
+    const char *part;
+};
+
+class IREmitter;
+
+/**
+ * Abstract class for Asynchronous Syntax Tree
+ * */
+class ASTNode
+{
+public:
+    virtual Value generateCode(IREmitter &output) = 0;
+    virtual int evaluate(vector<int> &variables) = 0;
+    virtual int compile(BytecodeCompiler &compiler, int target) = 0;
+    virtual ASTNode *fold(Arena &arena) = 0;
+    virtual const int *evaluateColumns(Columns &columns, const int *mask) = 0;
+ };
+
+/**
+ * Stores identifier of variables. Can generate code with temp variables
+ * */
+class IdentifierNode : public ASTNode
+{
+public:
+    const char *name;
+    int slot; //index of the variable in Parser::variables and in the variables of every backend
+    IdentifierNode(const char *_name, int _slot);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+    string getID();
+};
+
+
+/**
+ * Stores values for numbers. generateCode() function returns the integer value
+ * */
+class NumberNode : public ASTNode
+{
+public:
+    int value;
+    NumberNode(int _value);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node for choose expression, stores the expressions inside parantheses. 
+ * Generates code for both expressions and choose function.
+ * */
+class ChooseNode : public ASTNode
+{
+public:
+    ASTNode *expr1, *expr2, *expr3, *expr4;
+    ChooseNode(ASTNode *_expr1, ASTNode *_expr2, ASTNode *_expr3, ASTNode *_expr4);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node for binary operations. Stores the operation type, right and left handside as expressions
+ * and generates code for the calculation
+ * */
+class BinaryOperationNode : public ASTNode
+{
+public:
+    ASTNode *left;
+    ASTNode *right;
+    char operation;
+
+    BinaryOperationNode(ASTNode *_left, ASTNode *_right, char _operation);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node for division by a constant divisor, fold() creates it from BinaryOperationNode.
+ * The division is calculated with a multiplication and shifts instead of a division instruction
+ * */
+class ConstantDivisionNode : public ASTNode
+{
+public:
+    ASTNode *dividend;
+    int divisor;    //anything but 0, 1 and -1
+    int multiplier; //0 if the absolute value of divisor is a power of two
+    int shift;
+
+    ConstantDivisionNode(ASTNode *_dividend, int _divisor);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node for a division that always traps, by zero or INT_MIN / -1. fold() creates it from
+ * BinaryOperationNode, the operands are dropped since the division traps whatever they calculate
+ * */
+class TrapNode : public ASTNode
+{
+public:
+    TrapNode();
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node for print statements. Generates code for print statement and expression inside the statement
+ * */
+class PrintNode : public ASTNode
+{
+public:
+    ASTNode *expr;
+    PrintNode(ASTNode *_expr);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node to store conditional statements. Stores the condition, conditional type and statements
+ * inside the code block and generates code for all of them
+ * */
+class ConditionalNode : public ASTNode
+{
+public:
+    int type;
+    ASTNode *condition;
+    vector<ASTNode *> statements;
+
+    ConditionalNode(int _type, ASTNode *_condition);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node for assignment statement. Stores identifier and expression 
+ * Generates code for assignment statement
+ * */
+class AssignNode : public ASTNode
+{
+public:
+    IdentifierNode *identifier;
+    ASTNode *expr;
+    AssignNode(IdentifierNode *id, ASTNode *expr);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+extern thread_local FILE *programOutput; //where print writes, stdout when NULL
+
+/****************
+ * Bytecode
+ * **************/
+
+int Bytecode::registerCount()
+{
+    return variables.size() + temporaries + constants.size();
+}
+
+/**
+ * Returns a readable name for the register: variable name, t<N> for temporaries and #<value> for constants
+ * */
+string Bytecode::registerName(int index)
+{
+    if (index < (int)variables.size())
+        return variables[index];
+
+    index -= variables.size();
+
+    if (index < temporaries)
+        return "t" + to_string(index);
+
+    return "#" + to_string(constants[index - temporaries]);
+}
+
+/****************
+ * BytecodeCompiler
+ * **************/
+
+/**
+ * Gives every declared variable a register, the register of a variable is its slot
+ * */
+BytecodeCompiler::BytecodeCompiler(Bytecode *_bytecode, vector<string> &variables)
+{
+    this->bytecode = _bytecode;
+    this->nextTemporary = 0;
+
+    bytecode->temporaries = 0;
+
+    bytecode->variables = variables;
+}
+
+int BytecodeCompiler::variable(int slot)
+{
+    return slot;
+}
+
+/**
+ * Returns the register of a constant. The register index is not known until all temporaries
+ * are counted, so constants are encoded as negative numbers and fixed by finish()
+ * */
+int BytecodeCompiler::constant(int value)
+{
+    auto found = constantIndexes.find(value);
+
+    if (found != constantIndexes.end())
+        return -1 - found->second;
+
+    int index = bytecode->constants.size();
+    constantIndexes[value] = index;
+    bytecode->constants.push_back(value);
+
+    return -1 - index;
+}
+
+/**
+ * Allocates the next temporary register
+ * */
+int BytecodeCompiler::temporary()
+{
+    int index = nextTemporary++;
+
+    if (nextTemporary > bytecode->temporaries)
+        bytecode->temporaries = nextTemporary;
+
+    return bytecode->variables.size() + index;
+}
+
+/**
+ * Appends an instruction and returns its index
+ * */
+int BytecodeCompiler::emit(int opcode, int a, int b, int c)
+{
+    bytecode->code.push_back({opcode, a, b, c});
+    return bytecode->code.size() - 1;
+}
+
+/**
+ * Sets the target of a jump instruction that was emitted before its target was known
+ * */
+void BytecodeCompiler::patch(int index, int target)
+{
+    Instruction &instruction = bytecode->code[index];
+
+    if (instruction.opcode == op_jump)
+        instruction.a = target;
+    else
+        instruction.b = target;
+}
+
+/**
+ * Moves constants behind the temporaries now that the number of temporaries is known
+ * */
+void BytecodeCompiler::finish()
+{
+    int constantBase = bytecode->variables.size() + bytecode->temporaries;
+
+    auto relocate = [constantBase](int &operand) {
+        if (operand < 0)
+            operand = constantBase - 1 - operand;
+    };
+
+    for (auto &instruction : bytecode->code)
+    {
+        switch (instruction.opcode)
+        {
+        case (op_add):
+        case (op_sub):
+        case (op_mul):
+        case (op_div):
+            relocate(instruction.c);
+            //Falls through
+        case (op_move):
+        case (op_div_magic):
+        case (op_div_pow2):
+            relocate(instruction.b);
+            //Falls through
+        case (op_jump_zero):
+        case (op_jump_nonzero):
+        case (op_jump_less):
+        case (op_print):
+            relocate(instruction.a);
+            break;
+        }
+    }
+}
+
+/****************
+ * Node compilation
+ *
+ * compile() puts the value of the node into target and returns it. If target is -1 the node
+ * chooses the register itself, which may be a variable or constant register that must not be written.
+ * **************/
+
+int IdentifierNode::compile(BytecodeCompiler &compiler, int target)
+{
+    int source = compiler.variable(slot);
+
+    if (target < 0 || target == source)
+        return source;
+
+    compiler.emit(op_move, target, source);
+    return target;
+}
+
+int NumberNode::compile(BytecodeCompiler &compiler, int target)
+{
+    int source = compiler.constant(value);
+
+    if (target < 0)
+        return source;
+
+    compiler.emit(op_move, target, source);
+    return target;
+}
+
+/**
+ * Operations, constant divisions and chooses nested deeper than this compile their operands with
+ * compileExpression() instead of recursive calls
+ * */
+static const int recursionLimit = 1000;
+
+static thread_local int expressionDepth = 0;
+
+static int compileExpression(BytecodeCompiler &compiler, ASTNode *expression, int target);
+
+/**
+ * Emits the instruction of the operation once its operands are in registers. The temporaries of the
+ * operands above mark are released before the result register is chosen, so the result can reuse
+ * the register of an operand
+ * */
+static int operationBytecode(BytecodeCompiler &compiler, BinaryOperationNode *node, int target, int mark, int operand1, int operand2)
+{
+    compiler.nextTemporary = mark;
+
+    if (target < 0)
+        target = compiler.temporary();
+
+    int opcode;
+
+    switch (node->operation)
+    {
+    case ('+'):
+        opcode = op_add;
+        break;
+    case ('-'):
+        opcode = op_sub;
+        break;
+    case ('*'):
+        opcode = op_mul;
+        break;
+    default:
+        opcode = op_div;
+        break;
+    }
+
+    compiler.emit(opcode, target, operand1, operand2);
+
+    return target;
+}
+
+/**
+ * Compiles the operands into temporaries first
+ * */
+int BinaryOperationNode::compile(BytecodeCompiler &compiler, int target)
+{
+    if (expressionDepth >= recursionLimit)
+        return compileExpression(compiler, this, target);
+
+    int mark = compiler.nextTemporary;
+
+    expressionDepth++;
+    int operand1 = left->compile(compiler, -1);
+    int operand2 = right->compile(compiler, -1);
+    expressionDepth--;
+
+    return operationBytecode(compiler, this, target, mark, operand1, operand2);
+}
+
+/**
+ * Emits the division of the dividend in the operand register. The divisor is not a register
+ * operand, c indexes the constants of the division
+ * */
+static int constantDivisionBytecode(BytecodeCompiler &compiler, ConstantDivisionNode *node, int target, int mark, int operand)
+{
+    compiler.nextTemporary = mark;
+
+    if (target < 0)
+        target = compiler.temporary();
+
+    compiler.bytecode->divisors.push_back({node->divisor, node->multiplier, node->shift});
+    compiler.emit(node->multiplier == 0 ? op_div_pow2 : op_div_magic, target, operand, compiler.bytecode->divisors.size() - 1);
+
+    return target;
+}
+
+int ConstantDivisionNode::compile(BytecodeCompiler &compiler, int target)
+{
+    if (expressionDepth >= recursionLimit)
+        return compileExpression(compiler, this, target);
+
+    int mark = compiler.nextTemporary;
+
+    expressionDepth++;
+    int operand = dividend->compile(compiler, -1);
+    expressionDepth--;
+
+    return constantDivisionBytecode(compiler, this, target, mark, operand);
+}
+
+/**
+ * Divides zero by zero, so the VM traps where the division would have
+ * */
+int TrapNode::compile(BytecodeCompiler &compiler, int target)
+{
+    if (target < 0)
+        target = compiler.temporary();
+
+    int zero = compiler.constant(0);
+    compiler.emit(op_div, target, zero, zero);
+
+    return target;
+}
+
+/**
+ * Emits the part of a choose that comes after its expression number stage (1 to 4). value is the register
+ * of the first expression and jumps holds the jumps emitted so far that still need their target.
+ * Returns the register the branches write their result into
+ * */
+static int chooseBytecode(BytecodeCompiler &compiler, int stage, int &target, int mark, int value, int *jumps)
+{
+    switch (stage)
+    {
+    case (1):
+        //The value is only read by the jumps before the branches write the result, so the result can reuse its register
+        compiler.nextTemporary = mark;
+
+        if (target < 0)
+            target = compiler.temporary();
+
+        //value == 0 runs next
+        jumps[0] = compiler.emit(op_jump_nonzero, value, 0);
+        break;
+    case (2):
+        //value > 0
+        jumps[1] = compiler.emit(op_jump, 0);
+        compiler.patch(jumps[0], compiler.bytecode->code.size());
+        jumps[0] = compiler.emit(op_jump_less, value, 0);
+        break;
+    case (3):
+    {
+        //value < 0
+        int jumpEnd = compiler.emit(op_jump, 0);
+        compiler.patch(jumps[0], compiler.bytecode->code.size());
+        jumps[0] = jumpEnd;
+        break;
+    }
+    default:
+        compiler.patch(jumps[0], compiler.bytecode->code.size());
+        compiler.patch(jumps[1], compiler.bytecode->code.size());
+        break;
+    }
+
+    return target;
+}
+
+/**
+ * Branches on the first expression, every branch writes its result into the same register
+ * */
+int ChooseNode::compile(BytecodeCompiler &compiler, int target)
+{
+    if (expressionDepth >= recursionLimit)
+        return compileExpression(compiler, this, target);
+
+    int mark = compiler.nextTemporary;
+    int jumps[2];
+
+    expressionDepth++;
+    int value = expr1->compile(compiler, -1);
+    chooseBytecode(compiler, 1, target, mark, value, jumps);
+    expr2->compile(compiler, target);
+    chooseBytecode(compiler, 2, target, mark, value, jumps);
+    expr3->compile(compiler, target);
+    chooseBytecode(compiler, 3, target, mark, value, jumps);
+    expr4->compile(compiler, target);
+    chooseBytecode(compiler, 4, target, mark, value, jumps);
+    expressionDepth--;
+
+    return target;
+}
+
+/**
+ * Compiles an expression with an explicit stack instead of recursion, so expressions nested as deep as
+ * the parser allows do not overflow the stack. The operands of operations, constant divisions and
+ * chooses are compiled here in the order recursive calls would compile them, other nodes compile
+ * themselves. Shallow operations recurse, which is faster, till recursionLimit
+ * */
+static int compileExpression(BytecodeCompiler &compiler, ASTNode *expression, int target)
+{
+    //A node still to be compiled with the number of its operands compiled so far, the register it
+    //writes, the first free temporary before its operands and for a choose its value and open jumps
+    struct Step
+    {
+        ASTNode *node;
+        int stage;
+        int target;
+        int mark;
+        int value;
+        int jumps[2];
+    };
+
+    //The stacks are kept between calls, leaves compiled on the way may compile expressions of their own above them
+    static thread_local vector<Step> steps;
+    static thread_local vector<int> registers;
+
+    size_t base = steps.size();
+    steps.push_back(Step{expression, 0, target, 0, 0, {0, 0}});
+
+    while (steps.size() > base)
+    {
+        Step step = steps.back();
+        steps.pop_back();
+
+        if (step.stage == 0)
+            step.mark = compiler.nextTemporary;
+
+        if (BinaryOperationNode *operation = dynamic_cast<BinaryOperationNode *>(step.node))
+        {
+            if (step.stage == 0)
+            {
+                step.stage = 1;
+                steps.push_back(step);
+                steps.push_back(Step{operation->right, 0, -1, 0, 0, {0, 0}});
+                steps.push_back(Step{operation->left, 0, -1, 0, 0, {0, 0}});
+                continue;
+            }
+
+            int operand2 = registers.back();
+            registers.pop_back();
+            registers.back() = operationBytecode(compiler, operation, step.target, step.mark, registers.back(), operand2);
+        }
+        else if (ConstantDivisionNode *division = dynamic_cast<ConstantDivisionNode *>(step.node))
+        {
+            if (step.stage == 0)
+            {
+                step.stage = 1;
+                steps.push_back(step);
+                steps.push_back(Step{division->dividend, 0, -1, 0, 0, {0, 0}});
+                continue;
+            }
+
+            registers.back() = constantDivisionBytecode(compiler, division, step.target, step.mark, registers.back());
+        }
+        else if (ChooseNode *choose = dynamic_cast<ChooseNode *>(step.node))
+        {
+            //The register of the first expression is kept in the step, the branches write into the target
+            //and their registers are dropped. The last stage leaves the target as the register of the choose
+            ASTNode *expressions[] = {choose->expr1, choose->expr2, choose->expr3, choose->expr4};
+
+            if (step.stage > 0)
+            {
+                if (step.stage == 1)
+                    step.value = registers.back();
+
+                registers.pop_back();
+                chooseBytecode(compiler, step.stage, step.target, step.mark, step.value, step.jumps);
+            }
+
+            if (step.stage == 4)
+            {
+                registers.push_back(step.target);
+                continue;
+            }
+
+            ASTNode *next = expressions[step.stage];
+            int nextTarget = step.stage == 0 ? -1 : step.target;
+            step.stage++;
+            steps.push_back(step);
+            steps.push_back(Step{next, 0, nextTarget, 0, 0, {0, 0}});
+        }
+        else
+            registers.push_back(step.node->compile(compiler, step.target));
+    }
+
+    int result = registers.back();
+    registers.pop_back();
+    return result;
+}
+
+int PrintNode::compile(BytecodeCompiler &compiler, int)
+{
+    int mark = compiler.nextTemporary;
+
+    compiler.emit(op_print, expr->compile(compiler, -1));
+
+    compiler.nextTemporary = mark;
+    return -1;
+}
+
+/**
+ * while loops test the condition at the bottom so every iteration runs a single jump
+ * */
+int ConditionalNode::compile(BytecodeCompiler &compiler, int)
+{
+    int mark = compiler.nextTemporary;
+
+    if (this->type == 0)
+    {
+        int jumpEnd = compiler.emit(op_jump_zero, condition->compile(compiler, -1), 0);
+        compiler.nextTemporary = mark;
+
+        for (auto expression : statements)
+            expression->compile(compiler, -1);
+
+        compiler.patch(jumpEnd, compiler.bytecode->code.size());
+    }
+    else
+    {
+        int jumpCondition = compiler.emit(op_jump, 0);
+        int body = compiler.bytecode->code.size();
+
+        for (auto expression : statements)
+            expression->compile(compiler, -1);
+
+        compiler.patch(jumpCondition, compiler.bytecode->code.size());
+        compiler.emit(op_jump_nonzero, condition->compile(compiler, -1), body);
+        compiler.nextTemporary = mark;
+    }
+
+    return -1;
+}
+
+int AssignNode::compile(BytecodeCompiler &compiler, int)
+{
+    expr->compile(compiler, compiler.variable(identifier->slot));
+    return -1;
+}
+
+/****************
+ * Compiler entry points
+ * **************/
+
+/**
+ * Compiles the program into bytecode, variables get the registers in front of the frame
+ * */
+Bytecode *compileBytecode(vector<ASTNode *> &program, vector<string> &variables)
+{
+    Bytecode *bytecode = new Bytecode();
+    BytecodeCompiler compiler(bytecode, variables);
+
+    for (auto expression : program)
+    {
+        expression->compile(compiler, -1);
+    }
+
+    compiler.emit(op_halt, 0);
+    compiler.finish();
+
+    return bytecode;
+}
+
+/**
+ * Appends the bytecode to output in a binary form that loadBytecode() reads back,
+ * used to keep compiled programs in the compilation cache
+ * */
+void saveBytecode(Bytecode *bytecode, string &output)
+{
+    int header[5] = {(int)bytecode->code.size(), (int)bytecode->constants.size(), (int)bytecode->divisors.size(),
+                     (int)bytecode->variables.size(), bytecode->temporaries};
+
+    output.append((const char *)header, sizeof(header));
+    output.append((const char *)bytecode->code.data(), bytecode->code.size() * sizeof(Instruction));
+    output.append((const char *)bytecode->constants.data(), bytecode->constants.size() * sizeof(int));
+    output.append((const char *)bytecode->divisors.data(), bytecode->divisors.size() * sizeof(Divisor));
+
+    for (auto &name : bytecode->variables)
+    {
+        int length = name.size();
+        output.append((const char *)&length, sizeof(length));
+        output.append(name);
+    }
+}
+
+/**
+ * Returns true if every instruction has a known opcode, registers and divisors that exist and jump
+ * targets inside the code, and the code ends with halt. runBytecode() does not check any of these,
+ * so bytecode read from a cache entry of another build or a damaged file has to pass this first
+ * */
+static bool validCode(Bytecode *bytecode)
+{
+    int registers = bytecode->registerCount();
+    int size = bytecode->code.size();
+    int divisors = bytecode->divisors.size();
+
+    auto isRegister = [registers](int operand) { return operand >= 0 && operand < registers; };
+    auto isTarget = [size](int operand) { return operand >= 0 && operand < size; };
+
+    if (size == 0 || bytecode->code.back().opcode != op_halt)
+        return false;
+
+    for (auto &instruction : bytecode->code)
+    {
+        bool valid;
+
+        switch (instruction.opcode)
+        {
+        case (op_move):
+            valid = isRegister(instruction.a) && isRegister(instruction.b);
+            break;
+        case (op_add):
+        case (op_sub):
+        case (op_mul):
+        case (op_div):
+            valid = isRegister(instruction.a) && isRegister(instruction.b) && isRegister(instruction.c);
+            break;
+        case (op_div_magic):
+        case (op_div_pow2):
+            valid = isRegister(instruction.a) && isRegister(instruction.b) && instruction.c >= 0 && instruction.c < divisors;
+            break;
+        case (op_jump):
+            valid = isTarget(instruction.a);
+            break;
+        case (op_jump_zero):
+        case (op_jump_nonzero):
+        case (op_jump_less):
+            valid = isRegister(instruction.a) && isTarget(instruction.b);
+            break;
+        case (op_print):
+            valid = isRegister(instruction.a);
+            break;
+        case (op_halt):
+            valid = true;
+            break;
+        default:
+            valid = false;
+        }
+
+        if (!valid)
+            return false;
+    }
+
+    for (auto &divisor : bytecode->divisors)
+        if (divisor.shift < 0 || divisor.shift > 31)
+            return false;
+
+    return true;
+}
+
+/**
+ * Reads bytecode written by saveBytecode(), returns NULL if the data is cut short or the code
+ * is not valid, the program is compiled again then
+ * */
+Bytecode *loadBytecode(const string &data)
+{
+    const char *cursor = data.data(), *end = cursor + data.size();
+    int header[5];
+
+    auto read = [&cursor, end](void *target, size_t size) {
+        if ((size_t)(end - cursor) < size)
+            return false;
+        memcpy(target, cursor, size);
+        cursor += size;
+        return true;
+    };
+
+    if (!read(header, sizeof(header)))
+        return NULL;
+
+    for (int i = 0; i < 5; i++)
+        if (header[i] < 0 || (size_t)header[i] > data.size())
+            return NULL;
+
+    Bytecode *bytecode = new Bytecode();
+    bytecode->code.resize(header[0]);
+    bytecode->constants.resize(header[1]);
+    bytecode->divisors.resize(header[2]);
+    bytecode->temporaries = header[4];
+
+    bool complete = read(bytecode->code.data(), header[0] * sizeof(Instruction)) &&
+                    read(bytecode->constants.data(), header[1] * sizeof(int)) &&
+                    read(bytecode->divisors.data(), header[2] * sizeof(Divisor));
+
+    for (int i = 0; complete && i < header[3]; i++)
+    {
+        int length;
+        complete = read(&length, sizeof(length)) && length >= 0 && end - cursor >= length;
+
+        if (complete)
+        {
+            bytecode->variables.push_back(string(cursor, length));
+            cursor += length;
+        }
+    }
+
+    if (!complete || !validCode(bytecode))
+    {
+        delete bytecode;
+        return NULL;
+    }
+
+    return bytecode;
+}
+
+/**
+ * Frees bytecode returned by compileBytecode() or loadBytecode()
+ * */
+void deleteBytecode(Bytecode *bytecode)
+{
+    delete bytecode;
+}
+
+/**
+ * Runs the bytecode. With GCC and clang every handler jumps straight to the handler of the next
+ * instruction through a table of label addresses (computed goto), other compilers use a switch.
+ * The frame belongs to the thread and is reused by its next run, so nothing is lost when a division
+ * by zero in a server thread jumps out of the run.
+ * */
+void runBytecode(Bytecode *bytecode)
+{
+    static thread_local vector<int> frame;
+    frame.assign(bytecode->registerCount(), 0);
+
+    FILE *output = programOutput != NULL ? programOutput : stdout;
+
+    int constantBase = bytecode->variables.size() + bytecode->temporaries;
+    for (size_t i = 0; i < bytecode->constants.size(); i++)
+        frame[constantBase + i] = bytecode->constants[i];
+
+    int *r = frame.data();
+    const Instruction *code = bytecode->code.data();
+    const Instruction *pc = code;
+    const Divisor *divisors = bytecode->divisors.data();
+
+#if defined(__GNUC__)
+    static void *labels[] = {&&do_move, &&do_add, &&do_sub, &&do_mul, &&do_div, &&do_div_magic,
+                             &&do_div_pow2, &&do_jump, &&do_jump_zero, &&do_jump_nonzero, &&do_jump_less, &&do_print, &&do_halt};
+
+#define HANDLER(op) do_##op:
+#define JUMP(target) \
+    pc = (target);   \
+    goto *labels[pc->opcode]
+
+    goto *labels[pc->opcode];
+#else
+#define HANDLER(op) case (op_##op):
+#define JUMP(target) \
+    pc = (target);   \
+    continue
+
+    for (;;)
+    {
+        switch (pc->opcode)
+        {
+#endif
+
+    HANDLER(move)
+    {
+        r[pc->a] = r[pc->b];
+        JUMP(pc + 1);
+    }
+    HANDLER(add)
+    {
+        r[pc->a] = (int)((unsigned)r[pc->b] + (unsigned)r[pc->c]);
+        JUMP(pc + 1);
+    }
+    HANDLER(sub)
+    {
+        r[pc->a] = (int)((unsigned)r[pc->b] - (unsigned)r[pc->c]);
+        JUMP(pc + 1);
+    }
+    HANDLER(mul)
+    {
+        r[pc->a] = (int)((unsigned)r[pc->b] * (unsigned)r[pc->c]);
+        JUMP(pc + 1);
+    }
+    HANDLER(div)
+    {
+        int dividend = r[pc->b], divisor = r[pc->c];
+
+        //Division by zero and INT_MIN / -1 trap like sdiv
+        if (divisor == 0 || (dividend == INT_MIN && divisor == -1))
+            raise(SIGFPE);
+        else
+            r[pc->a] = dividend / divisor;
+        JUMP(pc + 1);
+    }
+    HANDLER(div_magic)
+    {
+        const Divisor &d = divisors[pc->c];
+        int dividend = r[pc->b];
+        unsigned quotient = (unsigned)(((long long)d.multiplier * dividend) >> 32);
+
+        if (d.divisor > 0 && d.multiplier < 0)
+            quotient += (unsigned)dividend;
+        else if (d.divisor < 0 && d.multiplier > 0)
+            quotient -= (unsigned)dividend;
+
+        quotient = (unsigned)((int)quotient >> d.shift);
+        r[pc->a] = (int)(quotient + (quotient >> 31));
+        JUMP(pc + 1);
+    }
+    HANDLER(div_pow2)
+    {
+        const Divisor &d = divisors[pc->c];
+        int dividend = r[pc->b];
+        unsigned bias = (unsigned)(dividend >> 31) >> (32 - d.shift);
+        int quotient = (int)((unsigned)dividend + bias) >> d.shift;
+
+        r[pc->a] = d.divisor < 0 ? (int)(0u - (unsigned)quotient) : quotient;
+        JUMP(pc + 1);
+    }
+    HANDLER(jump)
+    {
+        JUMP(code + pc->a);
+    }
+    HANDLER(jump_zero)
+    {
+        JUMP(r[pc->a] == 0 ? code + pc->b : pc + 1);
+    }
+    HANDLER(jump_nonzero)
+    {
+        JUMP(r[pc->a] != 0 ? code + pc->b : pc + 1);
+    }
+    HANDLER(jump_less)
+    {
+        JUMP(r[pc->a] < 0 ? code + pc->b : pc + 1);
+    }
+    HANDLER(print)
+    {
+        fprintf(output, "%d\n", r[pc->a]);
+        JUMP(pc + 1);
+    }
+    HANDLER(halt)
+    {
+        return;
+    }
+
+#if !defined(__GNUC__)
+        }
+    }
+#endif
+
+#undef HANDLER
+#undef JUMP
+}
+
+/**
+ * Prints the bytecode in readable form
+ * */
+void disassembleBytecode(Bytecode *bytecode, ostream &output)
+{
+    static const char *names[] = {"move", "add", "sub", "mul", "div", "divm", "divp", "jump",
+                                  "jz", "jnz", "jlt", "print", "halt"};
+
+    output << "; " << bytecode->code.size() << " instructions, " << bytecode->registerCount() << " registers ("
+           << bytecode->variables.size() << " variables, " << bytecode->temporaries << " temporaries, "
+           << bytecode->constants.size() << " constants)\n";
+
+    for (size_t i = 0; i < bytecode->code.size(); i++)
+    {
+        Instruction &instruction = bytecode->code[i];
+
+        output << setw(4) << setfill('0') << i << setfill(' ') << "  " << left << setw(7) << names[instruction.opcode] << right;
+
+        switch (instruction.opcode)
+        {
+        case (op_move):
+            output << bytecode->registerName(instruction.a) << ", " << bytecode->registerName(instruction.b);
+            break;
+        case (op_add):
+        case (op_sub):
+        case (op_mul):
+        case (op_div):
+            output << bytecode->registerName(instruction.a) << ", " << bytecode->registerName(instruction.b)
+                   << ", " << bytecode->registerName(instruction.c);
+            break;
+        case (op_div_magic):
+        case (op_div_pow2):
+            output << bytecode->registerName(instruction.a) << ", " << bytecode->registerName(instruction.b)
+                   << ", " << bytecode->divisors[instruction.c].divisor;
+            break;
+        case (op_jump):
+            output << instruction.a;
+            break;
+        case (op_jump_zero):
+        case (op_jump_nonzero):
+        case (op_jump_less):
+            output << bytecode->registerName(instruction.a) << ", " << instruction.b;
+            break;
+        case (op_print):
+            output << bytecode->registerName(instruction.a);
+            break;
+        }
+
+        output << "\n";
+    }
+}
@@ -0,0 +1,140 @@
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#include <thread>
+#include <functional>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+/**
+ * Directory of compiled programs (IR code or bytecode). Every entry is stored under a hash of the
+ * source text, the compiler and the options it was compiled with, so a program that did not change
+ * is read back from the cache without tokenizing and parsing it again.
+ * */
+class Cache
+{
+public:
+    string directory;
+    string compiler; //identifies the executable, entries of another build are never used
+
+    Cache(const string &_directory);
+
+    string key(const char *source, size_t size, const string &options);
+    bool load(const string &key, const char *kind, string &contents);
+    void store(const string &key, const char *kind, const string &contents);
+};
+
+/**
+ * Returns the size and modification time of the file, which change whenever it is rebuilt.
+ * Empty if the file does not exist
+ * */
+static string fileVersion(const string &path)
+{
+    struct stat status;
+
+    if (stat(path.c_str(), &status) != 0)
+        return "";
+
+    return to_string(status.st_size) + "." + to_string(status.st_mtim.tv_sec) + "." + to_string(status.st_mtim.tv_nsec);
+}
+
+/**
+ * Creates the directory if needed. The compiler is identified by the versions of the executable
+ * and of the LLVM backend next to it, which writes the bitcode entries
+ * */
+Cache::Cache(const string &_directory)
+{
+    this->directory = _directory;
+
+    if (!directory.empty() && directory.back() != '/')
+        directory += '/';
+
+    mkdir(directory.c_str(), 0755);
+
+    char path[4096];
+    ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    string executable = length > 0 ? string(path, length) : string("./division-interpreter");
+
+    compiler = fileVersion("/proc/self/exe") + "/" + fileVersion(executable.substr(0, executable.rfind('/') + 1) + "division-llvm.so");
+}
+
+/**
+ * Two 64 bit hashes over the same bytes, FNV-1a and FNV-1a with another multiplier
+ * */
+static void hashBytes(const char *data, size_t size, uint64_t &hash1, uint64_t &hash2)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        hash1 = (hash1 ^ (unsigned char)data[i]) * 0x100000001b3ULL;
+        hash2 = (hash2 ^ (unsigned char)data[i]) * 0x9e3779b97f4a7c15ULL;
+    }
+}
+
+/**
+ * Returns the name of the entry for the source compiled with the given options, 32 hex digits
+ * */
+string Cache::key(const char *source, size_t size, const string &options)
+{
+    uint64_t hash1 = 0xcbf29ce484222325ULL, hash2 = 0x84222325cbf29ce4ULL;
+    string prefix = compiler + '\0' + options + '\0' + to_string(size) + '\0';
+
+    hashBytes(prefix.data(), prefix.size(), hash1, hash2);
+    hashBytes(source, size, hash1, hash2);
+
+    char name[33];
+    snprintf(name, sizeof(name), "%016llx%016llx", (unsigned long long)hash1, (unsigned long long)hash2);
+    return name;
+}
+
+/**
+ * Reads the entry into contents, returns false if there is no such entry
+ * */
+bool Cache::load(const string &key, const char *kind, string &contents)
+{
+    int file = open((directory + key + "." + kind).c_str(), O_RDONLY);
+
+    if (file < 0)
+        return false;
+
+    struct stat status;
+    bool loaded = fstat(file, &status) == 0;
+
+    if (loaded)
+    {
+        contents.resize(status.st_size);
+
+        for (size_t done = 0; loaded && done < contents.size();)
+        {
+            ssize_t count = read(file, &contents[done], contents.size() - done);
+            loaded = count > 0;
+            done += count > 0 ? count : 0;
+        }
+    }
+
+    close(file);
+    return loaded;
+}
+
+/**
+ * Writes the entry to a temporary file first and renames it, so other processes never see
+ * a half written entry. Errors are ignored, the program is just compiled again next time
+ * */
+void Cache::store(const string &key, const char *kind, const string &contents)
+{
+    string path = directory + key + "." + kind;
+    string temporary = path + ".tmp" + to_string(getpid()) + "." + to_string(hash<thread::id>()(this_thread::get_id()));
+
+    FILE *file = fopen(temporary.c_str(), "wb");
+
+    if (file == NULL)
+        return;
+
+    bool written = fwrite(contents.data(), 1, contents.size(), file) == contents.size();
+    written = fclose(file) == 0 && written;
+
+    if (!written || rename(temporary.c_str(), path.c_str()) != 0)
+        unlink(temporary.c_str());
+}
@@ -0,0 +1,1105 @@
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <climits>
+#include <csignal>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+class BytecodeCompiler;
+class Arena;
+class Columns;
+
+/**
+ * Result of the code generation of an expression: an integer constant or the number of a temporary
+ * */
+struct Value
+{
+    bool temporary;
+    int number;
+};
+
+/**
+ * Name of a basic block, written as <kind>_<index><part> like cond_3body.
+ * Labels with a negative index are written as <kind> only
+ * */
+struct Label
+{
+    const char *kind;
+    int index;
+    const char *part;
+};
+
+class IREmitter;
+
+/**
+ * Abstract class for Asynchronous Syntax Tree
+ * */
+class ASTNode
+{
+public:
+    virtual Value generateCode(IREmitter &output) = 0;
+    virtual int evaluate(vector<int> &variables) = 0;
+    virtual int compile(BytecodeCompiler &compiler, int target) = 0;
+    virtual ASTNode *fold(Arena &arena) = 0;
+    virtual const int *evaluateColumns(Columns &columns, const int *mask) = 0;
+ };
+
+/**
+ * Stores identifier of variables. Can generate code with temp variables
+ * */
+class IdentifierNode : public ASTNode
+{
+public:
+    const char *name;
+    int slot; //index of the variable in Parser::variables and in the variables of every backend
+    IdentifierNode(const char *_name, int _slot);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+    string getID();
+};
+
+
+/**
+ * Stores values for numbers. generateCode() function returns the integer value
+ * */
+class NumberNode : public ASTNode
+{
+public:
+    int value;
+    NumberNode(int _value);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node for choose expression, stores the expressions inside parantheses. 
+ * Generates code for both expressions and choose function.
+ * */
+class ChooseNode : public ASTNode
+{
+public:
+    ASTNode *expr1, *expr2, *expr3, *expr4;
+    ChooseNode(ASTNode *_expr1, ASTNode *_expr2, ASTNode *_expr3, ASTNode *_expr4);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node for binary operations. Stores the operation type, right and left handside as expressions
+ * and generates code for the calculation
+ * */
+class BinaryOperationNode : public ASTNode
+{
+public:
+    ASTNode *left;
+    ASTNode *right;
+    char operation;
+
+    BinaryOperationNode(ASTNode *_left, ASTNode *_right, char _operation);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node for division by a constant divisor, fold() creates it from BinaryOperationNode.
+ * The division is calculated with a multiplication and shifts instead of a division instruction
+ * */
+class ConstantDivisionNode : public ASTNode
+{
+public:
+    ASTNode *dividend;
+    int divisor;    //anything but 0, 1 and -1
+    int multiplier; //0 if the absolute value of divisor is a power of two
+    int shift;
+
+    ConstantDivisionNode(ASTNode *_dividend, int _divisor);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node for a division that always traps, by zero or INT_MIN / -1. fold() creates it from
+ * BinaryOperationNode, the operands are dropped since the division traps whatever they calculate
+ * */
+class TrapNode : public ASTNode
+{
+public:
+    TrapNode();
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node for print statements. Generates code for print statement and expression inside the statement
+ * */
+class PrintNode : public ASTNode
+{
+public:
+    ASTNode *expr;
+    PrintNode(ASTNode *_expr);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node to store conditional statements. Stores the condition, conditional type and statements
+ * inside the code block and generates code for all of them
+ * */
+class ConditionalNode : public ASTNode
+{
+public:
+    int type;
+    ASTNode *condition;
+    vector<ASTNode *> statements;
+
+    ConditionalNode(int _type, ASTNode *_condition);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node for assignment statement. Stores identifier and expression 
+ * Generates code for assignment statement
+ * */
+class AssignNode : public ASTNode
+{
+public:
+    IdentifierNode *identifier;
+    ASTNode *expr;
+    AssignNode(IdentifierNode *id, ASTNode *expr);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+
+/**
+ * State of a columnar run. Every variable is a column with its value in each of width rows,
+ * the program runs over all rows at once. Masks hold -1 for the rows a statement runs for and
+ * 0 for the others, statements only change the rows set in their mask.
+ * */
+class Columns
+{
+public:
+    int width;                              //rows evaluated at once, a multiple of 8
+    vector<int *> variables;                //column of every variable slot
+    vector<int *> scratch;                  //columns for intermediate results, allocated like a stack
+    size_t scratchUsed;
+    int *trapped;                           //-1 for the rows whose division trapped, they do not run any further
+    vector<pair<int, int>> output;          //row and value of every print, in the order they ran
+
+    Columns(int _width, vector<string> &names);
+    ~Columns();
+
+    int *variable(int slot);
+    int *temporary();
+    int *live(const int *mask);
+};
+
+/**
+ * Rows of a table are run in blocks of this size, small enough for the columns to stay in the cache
+ * */
+static const int columnWidth = 1024;
+
+/****************
+ * Kernels
+ *
+ * Arithmetic on whole columns. Every kernel has an AVX2 version and an SSE2 version, the AVX2
+ * version is used when the processor supports it. Columns are a multiple of 8 values long.
+ * **************/
+
+#if defined(__x86_64__)
+
+static bool hasAVX2()
+{
+    static bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+
+/**
+ * result = left + right, left - right or left * right, wrapping around like the IR code
+ * */
+__attribute__((target("avx2"))) static void arithmeticAVX2(char operation, const int *left, const int *right, int *result, int width)
+{
+    for (int i = 0; i < width; i += 8)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(left + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(right + i));
+        __m256i value;
+
+        switch (operation)
+        {
+        case ('+'):
+            value = _mm256_add_epi32(a, b);
+            break;
+        case ('-'):
+            value = _mm256_sub_epi32(a, b);
+            break;
+        default:
+            value = _mm256_mullo_epi32(a, b);
+            break;
+        }
+
+        _mm256_storeu_si256((__m256i *)(result + i), value);
+    }
+}
+
+static void arithmeticSSE2(char operation, const int *left, const int *right, int *result, int width)
+{
+    for (int i = 0; i < width; i += 4)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(left + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(right + i));
+        __m128i value;
+
+        switch (operation)
+        {
+        case ('+'):
+            value = _mm_add_epi32(a, b);
+            break;
+        case ('-'):
+            value = _mm_sub_epi32(a, b);
+            break;
+        default:
+        {
+            //SSE2 has no 32 bit multiplication, the low halves of two 64 bit products per register are merged
+            __m128i even = _mm_mul_epu32(a, b);
+            __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+            value = _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+            break;
+        }
+        }
+
+        _mm_storeu_si128((__m128i *)(result + i), value);
+    }
+}
+
+/**
+ * result = left / right. Rows that would trap (division by zero, INT_MIN / -1) are divided by 1
+ * instead and marked in trapped if they are live. Every i32 quotient is exact in double, so the
+ * division is done in double precision and truncated like sdiv.
+ * */
+__attribute__((target("avx2"))) static void divideAVX2(const int *left, const int *right, int *result, const int *mask, int *trapped, int width)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i minusOne = _mm256_set1_epi32(-1);
+    const __m256i minimum = _mm256_set1_epi32(INT_MIN);
+
+    for (int i = 0; i < width; i += 8)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(left + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(right + i));
+        __m256i stopped = _mm256_loadu_si256((const __m256i *)(trapped + i));
+        __m256i active = _mm256_andnot_si256(stopped, _mm256_loadu_si256((const __m256i *)(mask + i)));
+
+        __m256i trap = _mm256_or_si256(_mm256_cmpeq_epi32(b, zero),
+                                       _mm256_and_si256(_mm256_cmpeq_epi32(a, minimum), _mm256_cmpeq_epi32(b, minusOne)));
+        _mm256_storeu_si256((__m256i *)(trapped + i), _mm256_or_si256(stopped, _mm256_and_si256(trap, active)));
+        b = _mm256_blendv_epi8(b, one, trap);
+
+        __m256d low = _mm256_div_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(a)), _mm256_cvtepi32_pd(_mm256_castsi256_si128(b)));
+        __m256d high = _mm256_div_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(a, 1)), _mm256_cvtepi32_pd(_mm256_extracti128_si256(b, 1)));
+        __m256i quotient = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm256_cvttpd_epi32(low)), _mm256_cvttpd_epi32(high), 1);
+
+        _mm256_storeu_si256((__m256i *)(result + i), quotient);
+    }
+}
+
+static void divideSSE2(const int *left, const int *right, int *result, const int *mask, int *trapped, int width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i minusOne = _mm_set1_epi32(-1);
+    const __m128i minimum = _mm_set1_epi32(INT_MIN);
+
+    for (int i = 0; i < width; i += 4)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(left + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(right + i));
+        __m128i stopped = _mm_loadu_si128((const __m128i *)(trapped + i));
+        __m128i active = _mm_andnot_si128(stopped, _mm_loadu_si128((const __m128i *)(mask + i)));
+
+        __m128i trap = _mm_or_si128(_mm_cmpeq_epi32(b, zero), _mm_and_si128(_mm_cmpeq_epi32(a, minimum), _mm_cmpeq_epi32(b, minusOne)));
+        _mm_storeu_si128((__m128i *)(trapped + i), _mm_or_si128(stopped, _mm_and_si128(trap, active)));
+        b = _mm_or_si128(_mm_and_si128(trap, one), _mm_andnot_si128(trap, b));
+
+        //Two rows per division, the upper two rows are moved down for the second one
+        __m128i low = _mm_cvttpd_epi32(_mm_div_pd(_mm_cvtepi32_pd(a), _mm_cvtepi32_pd(b)));
+        __m128i high = _mm_cvttpd_epi32(_mm_div_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(a, _MM_SHUFFLE(1, 0, 3, 2))),
+                                                   _mm_cvtepi32_pd(_mm_shuffle_epi32(b, _MM_SHUFFLE(1, 0, 3, 2)))));
+
+        _mm_storeu_si128((__m128i *)(result + i), _mm_unpacklo_epi64(low, high));
+    }
+}
+
+/**
+ * result = left / divisor with the constants of a ConstantDivisionNode, the same sequence as
+ * its IR code. Only AVX2 has a signed 32 bit multiplication into 64 bits.
+ * */
+__attribute__((target("avx2"))) static void divideConstantAVX2(const int *left, int *result, int divisor, int multiplier, int shift, int width)
+{
+    const __m256i magic = _mm256_set1_epi32(multiplier);
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    const __m128i biasCount = _mm_cvtsi32_si128(32 - shift);
+
+    for (int i = 0; i < width; i += 8)
+    {
+        __m256i n = _mm256_loadu_si256((const __m256i *)(left + i));
+        __m256i quotient;
+
+        if (multiplier == 0)
+        {
+            __m256i bias = _mm256_srl_epi32(_mm256_srai_epi32(n, 31), biasCount);
+            quotient = _mm256_sra_epi32(_mm256_add_epi32(n, bias), count);
+
+            if (divisor < 0)
+                quotient = _mm256_sub_epi32(_mm256_setzero_si256(), quotient);
+        }
+        else
+        {
+            //High halves of the products of the even and the odd rows
+            __m256i even = _mm256_srli_epi64(_mm256_mul_epi32(n, magic), 32);
+            __m256i odd = _mm256_mul_epi32(_mm256_srli_epi64(n, 32), magic);
+            quotient = _mm256_blend_epi32(even, odd, 0xAA);
+
+            if (divisor > 0 && multiplier < 0)
+                quotient = _mm256_add_epi32(quotient, n);
+            else if (divisor < 0 && multiplier > 0)
+                quotient = _mm256_sub_epi32(quotient, n);
+
+            quotient = _mm256_sra_epi32(quotient, count);
+            quotient = _mm256_add_epi32(quotient, _mm256_srli_epi32(quotient, 31));
+        }
+
+        _mm256_storeu_si256((__m256i *)(result + i), quotient);
+    }
+}
+
+#endif
+
+static void arithmeticColumns(char operation, const int *left, const int *right, int *result, int width)
+{
+#if defined(__x86_64__)
+    if (hasAVX2())
+        arithmeticAVX2(operation, left, right, result, width);
+    else
+        arithmeticSSE2(operation, left, right, result, width);
+#else
+    for (int i = 0; i < width; i++)
+    {
+        unsigned a = left[i], b = right[i];
+        result[i] = (int)(operation == '+' ? a + b : operation == '-' ? a - b : a * b);
+    }
+#endif
+}
+
+static void divideColumns(const int *left, const int *right, int *result, const int *mask, int *trapped, int width)
+{
+#if defined(__x86_64__)
+    if (hasAVX2())
+        divideAVX2(left, right, result, mask, trapped, width);
+    else
+        divideSSE2(left, right, result, mask, trapped, width);
+#else
+    for (int i = 0; i < width; i++)
+    {
+        int divisor = right[i];
+
+        if (divisor == 0 || (left[i] == INT_MIN && divisor == -1))
+        {
+            trapped[i] |= mask[i];
+            divisor = 1;
+        }
+
+        result[i] = left[i] / divisor;
+    }
+#endif
+}
+
+/**
+ * Without AVX2 the rows are divided one by one with the formula of ConstantDivisionNode::evaluate()
+ * */
+static void divideConstantColumns(const int *left, int *result, int divisor, int multiplier, int shift, int width)
+{
+#if defined(__x86_64__)
+    if (hasAVX2())
+    {
+        divideConstantAVX2(left, result, divisor, multiplier, shift, width);
+        return;
+    }
+#endif
+
+    for (int i = 0; i < width; i++)
+    {
+        int value = left[i];
+
+        if (multiplier == 0)
+        {
+            unsigned bias = (unsigned)(value >> 31) >> (32 - shift);
+            int quotient = (int)((unsigned)value + bias) >> shift;
+            result[i] = divisor < 0 ? (int)(0u - (unsigned)quotient) : quotient;
+            continue;
+        }
+
+        unsigned quotient = (unsigned)(((long long)multiplier * value) >> 32);
+
+        if (divisor > 0 && multiplier < 0)
+            quotient += (unsigned)value;
+        else if (divisor < 0 && multiplier > 0)
+            quotient -= (unsigned)value;
+
+        int shifted = (int)quotient >> shift;
+        result[i] = shifted + (int)((unsigned)shifted >> 31);
+    }
+}
+
+/**
+ * Returns true if any row of the mask is set
+ * */
+static bool anySet(const int *mask, int width)
+{
+    int any = 0;
+
+    for (int i = 0; i < width; i++)
+        any |= mask[i];
+
+    return any != 0;
+}
+
+/****************
+ * Columns
+ * **************/
+
+/**
+ * Creates a column for every variable of the program
+ * */
+Columns::Columns(int _width, vector<string> &names)
+{
+    this->width = _width;
+    this->scratchUsed = 0;
+    this->trapped = new int[_width]();
+
+    for (size_t slot = 0; slot < names.size(); slot++)
+        variables.push_back(new int[_width]());
+}
+
+Columns::~Columns()
+{
+    for (auto column : variables)
+        delete[] column;
+
+    for (auto column : scratch)
+        delete[] column;
+
+    delete[] trapped;
+}
+
+int *Columns::variable(int slot)
+{
+    return variables[slot];
+}
+
+/**
+ * Allocates the next scratch column, release it by resetting scratchUsed
+ * */
+int *Columns::temporary()
+{
+    if (scratchUsed == scratch.size())
+        scratch.push_back(new int[width]());
+
+    return scratch[scratchUsed++];
+}
+
+/**
+ * Returns the rows of the mask that did not trap, in a new scratch column
+ * */
+int *Columns::live(const int *mask)
+{
+    int *result = temporary();
+
+    for (int i = 0; i < width; i++)
+        result[i] = mask[i] & ~trapped[i];
+
+    return result;
+}
+
+/****************
+ * Node evaluation over columns
+ *
+ * evaluateColumns() returns the column holding the value of the node in every row. Only the rows
+ * set in the mask are meaningful. The column may belong to a variable and must not be written.
+ * Statements return NULL.
+ * **************/
+
+const int *IdentifierNode::evaluateColumns(Columns &columns, const int *mask)
+{
+    return columns.variable(slot);
+}
+
+const int *NumberNode::evaluateColumns(Columns &columns, const int *mask)
+{
+    int *result = columns.temporary();
+    fill(result, result + columns.width, value);
+    return result;
+}
+
+/**
+ * Operations, constant divisions and chooses nested deeper than this evaluate their operands with
+ * evaluateExpressionColumns() instead of recursive calls
+ * */
+static const int recursionLimit = 1000;
+
+static thread_local int expressionDepth = 0;
+
+static const int *evaluateExpressionColumns(Columns &columns, ASTNode *expression, const int *mask);
+
+/**
+ * Sets branchMask to the rows of the mask that choose the branch (0 to 2) of a choose and did not trap.
+ * Returns false if there are none, the branch is skipped then
+ * */
+static bool chooseBranch(Columns &columns, int branch, const int *value, const int *mask, int *branchMask)
+{
+    for (int i = 0; i < columns.width; i++)
+    {
+        bool chosen = branch == 0 ? value[i] == 0 : branch == 1 ? value[i] > 0 : value[i] < 0;
+        branchMask[i] = mask[i] & ~columns.trapped[i] & -(int)chosen;
+    }
+
+    return anySet(branchMask, columns.width);
+}
+
+/**
+ * Copies the value of a branch into the result for the rows that chose it
+ * */
+static void mergeBranch(Columns &columns, int *result, const int *branchValue, const int *branchMask)
+{
+    for (int i = 0; i < columns.width; i++)
+        result[i] = (branchValue[i] & branchMask[i]) | (result[i] & ~branchMask[i]);
+}
+
+/**
+ * Every branch runs for the rows that choose it, the result is merged from the three branches.
+ * The result column is allocated first so it stays in place when the rest is released
+ * */
+const int *ChooseNode::evaluateColumns(Columns &columns, const int *mask)
+{
+    if (expressionDepth >= recursionLimit)
+        return evaluateExpressionColumns(columns, this, mask);
+
+    size_t mark = columns.scratchUsed;
+
+    expressionDepth++;
+    int *result = columns.temporary();
+    const int *value = expr1->evaluateColumns(columns, mask);
+    int *branchMask = columns.temporary();
+    ASTNode *branches[3] = {expr2, expr3, expr4};
+
+    for (int branch = 0; branch < 3; branch++)
+    {
+        if (!chooseBranch(columns, branch, value, mask, branchMask))
+            continue;
+
+        size_t branchMark = columns.scratchUsed;
+        mergeBranch(columns, result, branches[branch]->evaluateColumns(columns, branchMask), branchMask);
+        columns.scratchUsed = branchMark;
+    }
+    expressionDepth--;
+
+    columns.scratchUsed = mark + 1;
+    return result;
+}
+
+/**
+ * Calculates the operation once the operand columns are evaluated. The operands above mark are
+ * released before the result column is allocated, so the result can reuse the column of an operand
+ * */
+static const int *operationColumns(Columns &columns, BinaryOperationNode *node, const int *mask, size_t mark,
+                                   const int *operand1, const int *operand2)
+{
+    columns.scratchUsed = mark;
+    int *result = columns.temporary();
+
+    if (node->operation == '/')
+        divideColumns(operand1, operand2, result, mask, columns.trapped, columns.width);
+    else
+        arithmeticColumns(node->operation, operand1, operand2, result, columns.width);
+
+    return result;
+}
+
+const int *BinaryOperationNode::evaluateColumns(Columns &columns, const int *mask)
+{
+    if (expressionDepth >= recursionLimit)
+        return evaluateExpressionColumns(columns, this, mask);
+
+    size_t mark = columns.scratchUsed;
+
+    expressionDepth++;
+    const int *operand1 = left->evaluateColumns(columns, mask);
+    const int *operand2 = right->evaluateColumns(columns, mask);
+    expressionDepth--;
+
+    return operationColumns(columns, this, mask, mark, operand1, operand2);
+}
+
+/**
+ * Divides the operand column with the constants of the node, like operationColumns()
+ * */
+static const int *constantDivisionColumns(Columns &columns, ConstantDivisionNode *node, size_t mark, const int *operand)
+{
+    columns.scratchUsed = mark;
+    int *result = columns.temporary();
+
+    divideConstantColumns(operand, result, node->divisor, node->multiplier, node->shift, columns.width);
+
+    return result;
+}
+
+const int *ConstantDivisionNode::evaluateColumns(Columns &columns, const int *mask)
+{
+    if (expressionDepth >= recursionLimit)
+        return evaluateExpressionColumns(columns, this, mask);
+
+    size_t mark = columns.scratchUsed;
+
+    expressionDepth++;
+    const int *operand = dividend->evaluateColumns(columns, mask);
+    expressionDepth--;
+
+    return constantDivisionColumns(columns, this, mark, operand);
+}
+
+/**
+ * Evaluates an expression over the columns with an explicit stack instead of recursion, so expressions
+ * nested as deep as the parser allows do not overflow the stack. The operands of operations, constant
+ * divisions and chooses are evaluated here in the order recursive calls would evaluate them, other
+ * nodes evaluate themselves. Shallow operations recurse, which is faster, till recursionLimit
+ * */
+static const int *evaluateExpressionColumns(Columns &columns, ASTNode *expression, const int *mask)
+{
+    //A node still to be evaluated with the number of its operands evaluated so far, the rows it runs
+    //for and the scratch columns in use before it. A choose also keeps its result, the value of its
+    //first expression and the rows of the branch being evaluated
+    struct Step
+    {
+        ASTNode *node;
+        int stage;
+        const int *mask;
+        size_t mark;
+        int *result;
+        const int *value;
+        int *branchMask;
+        size_t branchMark;
+    };
+
+    //The stacks are kept between calls, leaves evaluated on the way may evaluate expressions of their own above them
+    static thread_local vector<Step> steps;
+    static thread_local vector<const int *> values;
+
+    size_t base = steps.size();
+    steps.push_back(Step{expression, 0, mask, 0, NULL, NULL, NULL, 0});
+
+    while (steps.size() > base)
+    {
+        Step step = steps.back();
+        steps.pop_back();
+
+        if (step.stage == 0)
+            step.mark = columns.scratchUsed;
+
+        if (BinaryOperationNode *operation = dynamic_cast<BinaryOperationNode *>(step.node))
+        {
+            if (step.stage == 0)
+            {
+                step.stage = 1;
+                steps.push_back(step);
+                steps.push_back(Step{operation->right, 0, step.mask, 0, NULL, NULL, NULL, 0});
+                steps.push_back(Step{operation->left, 0, step.mask, 0, NULL, NULL, NULL, 0});
+                continue;
+            }
+
+            const int *operand2 = values.back();
+            values.pop_back();
+            values.back() = operationColumns(columns, operation, step.mask, step.mark, values.back(), operand2);
+        }
+        else if (ConstantDivisionNode *division = dynamic_cast<ConstantDivisionNode *>(step.node))
+        {
+            if (step.stage == 0)
+            {
+                step.stage = 1;
+                steps.push_back(step);
+                steps.push_back(Step{division->dividend, 0, step.mask, 0, NULL, NULL, NULL, 0});
+                continue;
+            }
+
+            values.back() = constantDivisionColumns(columns, division, step.mark, values.back());
+        }
+        else if (ChooseNode *choose = dynamic_cast<ChooseNode *>(step.node))
+        {
+            //Stage 1 has the value of the first expression, stages 2 to 4 the value of the branch
+            //stage - 2. The branches that no row chooses are skipped
+            ASTNode *branches[3] = {choose->expr2, choose->expr3, choose->expr4};
+
+            if (step.stage == 0)
+            {
+                step.result = columns.temporary();
+                step.stage = 1;
+                steps.push_back(step);
+                steps.push_back(Step{choose->expr1, 0, step.mask, 0, NULL, NULL, NULL, 0});
+                continue;
+            }
+
+            if (step.stage == 1)
+            {
+                step.value = values.back();
+                step.branchMask = columns.temporary();
+                step.branchMark = columns.scratchUsed;
+            }
+            else
+            {
+                mergeBranch(columns, step.result, values.back(), step.branchMask);
+                columns.scratchUsed = step.branchMark;
+            }
+            values.pop_back();
+
+            int branch = step.stage - 1;
+
+            while (branch < 3 && !chooseBranch(columns, branch, step.value, step.mask, step.branchMask))
+                branch++;
+
+            if (branch == 3)
+            {
+                columns.scratchUsed = step.mark + 1;
+                values.push_back(step.result);
+                continue;
+            }
+
+            step.stage = branch + 2;
+            steps.push_back(step);
+            steps.push_back(Step{branches[branch], 0, step.branchMask, 0, NULL, NULL, NULL, 0});
+        }
+        else
+            values.push_back(step.node->evaluateColumns(columns, step.mask));
+    }
+
+    const int *result = values.back();
+    values.pop_back();
+    return result;
+}
+
+/**
+ * Every row of the mask traps
+ * */
+const int *TrapNode::evaluateColumns(Columns &columns, const int *mask)
+{
+    int *result = columns.temporary();
+
+    for (int i = 0; i < columns.width; i++)
+    {
+        columns.trapped[i] |= mask[i];
+        result[i] = 0;
+    }
+
+    return result;
+}
+
+/**
+ * Prints are collected with their row, rows that trapped while the expression was evaluated print nothing
+ * */
+const int *PrintNode::evaluateColumns(Columns &columns, const int *mask)
+{
+    size_t mark = columns.scratchUsed;
+
+    const int *value = expr->evaluateColumns(columns, mask);
+
+    for (int i = 0; i < columns.width; i++)
+    {
+        if (mask[i] & ~columns.trapped[i])
+            columns.output.push_back(make_pair(i, value[i]));
+    }
+
+    columns.scratchUsed = mark;
+    return NULL;
+}
+
+/**
+ * if runs the statements for the rows where the condition is not 0. while repeats that with the
+ * rows still in the loop until none is left.
+ * */
+const int *ConditionalNode::evaluateColumns(Columns &columns, const int *mask)
+{
+    size_t mark = columns.scratchUsed;
+
+    int *active = columns.temporary();
+    copy(mask, mask + columns.width, active);
+
+    do
+    {
+        size_t conditionMark = columns.scratchUsed;
+        const int *value = condition->evaluateColumns(columns, active);
+
+        for (int i = 0; i < columns.width; i++)
+            active[i] &= ~columns.trapped[i] & -(int)(value[i] != 0);
+
+        columns.scratchUsed = conditionMark;
+
+        if (!anySet(active, columns.width))
+            break;
+
+        for (auto expression : statements)
+            expression->evaluateColumns(columns, active);
+
+    } while (this->type != 0);
+
+    columns.scratchUsed = mark;
+    return NULL;
+}
+
+/**
+ * Only the rows in the mask that did not trap take the new value
+ * */
+const int *AssignNode::evaluateColumns(Columns &columns, const int *mask)
+{
+    size_t mark = columns.scratchUsed;
+
+    const int *value = expr->evaluateColumns(columns, mask);
+    int *live = columns.live(mask);
+    int *variable = columns.variable(identifier->slot);
+
+    for (int i = 0; i < columns.width; i++)
+        variable[i] = (value[i] & live[i]) | (variable[i] & ~live[i]);
+
+    columns.scratchUsed = mark;
+    return NULL;
+}
+
+/****************
+ * Columnar runs
+ * **************/
+
+/**
+ * Reads a table of inputs. The first line names the variables, every other line holds the values
+ * of one row separated by commas. Values wrap around to 32 bits like literals of the language.
+ * Returns false and prints an error if the file can not be read or a line is not a valid row.
+ * */
+static bool readTable(const string &fileName, vector<string> &names, vector<vector<int>> &table)
+{
+    ifstream file(fileName, ios::binary);
+
+    if (!file)
+    {
+        cerr << "division-interpreter: can not read " << fileName << "\n";
+        return false;
+    }
+
+    string line;
+    int lineNumber = 0;
+
+    while (getline(file, line))
+    {
+        lineNumber++;
+
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+
+        if (line.find_first_not_of(" \t") == string::npos)
+            continue;
+
+        //Header
+        if (names.empty())
+        {
+            stringstream header(line);
+            string name;
+
+            while (getline(header, name, ','))
+            {
+                size_t first = name.find_first_not_of(" \t"), last = name.find_last_not_of(" \t");
+                names.push_back(first == string::npos ? "" : name.substr(first, last - first + 1));
+            }
+
+            table.resize(names.size());
+            continue;
+        }
+
+        const char *cursor = line.c_str();
+        size_t column = 0;
+
+        for (;; column++)
+        {
+            while (*cursor == ' ' || *cursor == '\t')
+                cursor++;
+
+            bool negative = *cursor == '-';
+            cursor += negative;
+
+            if (*cursor < '0' || *cursor > '9' || column >= names.size())
+                break;
+
+            unsigned value = 0;
+
+            while (*cursor >= '0' && *cursor <= '9')
+                value = value * 10 + (*cursor++ - '0');
+
+            while (*cursor == ' ' || *cursor == '\t')
+                cursor++;
+
+            table[column].push_back((int)(negative ? 0u - value : value));
+
+            if (*cursor != ',')
+            {
+                column++;
+                break;
+            }
+
+            cursor++;
+        }
+
+        if (*cursor != '\0' || column != names.size())
+        {
+            cerr << "division-interpreter: " << fileName << ":" << lineNumber << ": expected " << names.size() << " integers\n";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Runs the program once for every row of the table, with the variables named in the header set to
+ * the values of the row and every other variable starting at 0. The output is the output of the
+ * rows one after the other. If a row divides by zero, the output stops at that division and the
+ * process raises SIGFPE, like running the rows one by one would.
+ *
+ * The rows are run in blocks of columnWidth rows over columns. With scalar set they are run one
+ * by one with evaluate() instead, which is what the columnar run is checked against.
+ * Returns 1 if the table can not be read.
+ * */
+int runColumns(vector<ASTNode *> &program, vector<string> &variables, const string &fileName, bool scalar)
+{
+    vector<string> names;
+    vector<vector<int>> table;
+
+    if (!readTable(fileName, names, table))
+        return 1;
+
+    int rows = table.empty() ? 0 : table[0].size();
+
+    //Slot of the variable every column sets, -1 for columns naming no variable of the program
+    unordered_map<string, int> slots;
+    vector<int> columnSlots;
+
+    for (size_t slot = 0; slot < variables.size(); slot++)
+        slots[variables[slot]] = slot;
+
+    for (auto &name : names)
+    {
+        auto found = slots.find(name);
+        columnSlots.push_back(found != slots.end() ? found->second : -1);
+    }
+
+    if (scalar)
+    {
+        for (int row = 0; row < rows; row++)
+        {
+            vector<int> values(variables.size());
+
+            for (size_t column = 0; column < names.size(); column++)
+            {
+                if (columnSlots[column] >= 0)
+                    values[columnSlots[column]] = table[column][row];
+            }
+
+            for (auto expression : program)
+                expression->evaluate(values);
+        }
+
+        return 0;
+    }
+
+    Columns columns(columnWidth, variables);
+    vector<int> mask(columnWidth);
+
+    for (int first = 0; first < rows; first += columnWidth)
+    {
+        int count = min(columnWidth, rows - first);
+
+        //Every block starts from the inputs, rows past the end of the table stay masked out
+        for (auto variable : columns.variables)
+            fill(variable, variable + columnWidth, 0);
+
+        for (size_t column = 0; column < names.size(); column++)
+        {
+            if (columnSlots[column] >= 0)
+                copy(table[column].begin() + first, table[column].begin() + first + count, columns.variable(columnSlots[column]));
+        }
+
+        for (int i = 0; i < columnWidth; i++)
+            mask[i] = i < count ? -1 : 0;
+
+        fill(columns.trapped, columns.trapped + columnWidth, 0);
+        columns.output.clear();
+
+        for (auto expression : program)
+            expression->evaluateColumns(columns, mask.data());
+
+        //Prints are collected statement by statement, sorting by row keeps the order within a row
+        stable_sort(columns.output.begin(), columns.output.end(),
+                    [](const pair<int, int> &a, const pair<int, int> &b) { return a.first < b.first; });
+
+        int trappedRow = find(columns.trapped, columns.trapped + columnWidth, -1) - columns.trapped;
+
+        for (auto &printed : columns.output)
+        {
+            if (printed.first > trappedRow)
+                break;
+
+            printf("%d\n", printed.second);
+        }
+
+        if (trappedRow < columnWidth)
+        {
+            fflush(stdout);
+            raise(SIGFPE);
+        }
+    }
+
+    return 0;
+}
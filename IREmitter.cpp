@@ -0,0 +1,221 @@
+#include <ostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+using namespace std;
+
+/**
+ * Result of the code generation of an expression: an integer constant or the number of a temporary
+ * */
+struct Value
+{
+    bool temporary;
+    int number;
+};
+
+/**
+ * Name of a basic block, written as <kind>_<index><part> like cond_3body.
+ * Labels with a negative index are written as <kind> only
+ * */
+struct Label
+{
+    const char *kind;
+    int index;
+    const char *part;
+};
+
+/**
+ * Reciprocal of a divisor that does not change in a while loop, calculated in front of the loop
+ * */
+struct Reciprocal
+{
+    Value divisor;    //the divisor it belongs to
+    Value multiplier; //i128, ceil(2^64 / |divisor|)
+    Value usable;     //i1, false for the divisors 0, 1 and -1, which are divided with sdiv
+};
+
+/**
+ * Writes IR code into a growing byte buffer instead of streaming every fragment separately.
+ * Numbers and temporaries are formatted straight into the buffer, the buffer is written to
+ * the output in large blocks by flushIfFull() and flush()
+ * */
+class IREmitter
+{
+public:
+    ostream &output;
+    char *buffer;
+    size_t size;
+    size_t capacity;
+
+    //State of the code generation of one program
+    int tempIndex;                       //number of the next temporary
+    int conditionalIndex;                //number of the next if/while, used in its labels
+    int chooseIndex;                     //number of the next choose, used in its labels
+    int divisionIndex;                   //number of the next division by a reciprocal, used in its labels
+    vector<Value> values;                //SSA value of every variable slot at the current point of code generation
+    unordered_map<int, Reciprocal> reciprocals; //reciprocals of the divisors of the loops being generated, by slot
+    Label block;                         //label of the basic block code is being generated into
+
+    IREmitter(ostream &_output);
+    ~IREmitter();
+
+    IREmitter &operator<<(const char *text);
+    IREmitter &operator<<(char character);
+    IREmitter &operator<<(int number);
+    IREmitter &operator<<(Value value);
+    IREmitter &operator<<(const Label &label);
+
+    Value temporary();
+    size_t mark();
+    void moveTo(size_t mark, size_t start);
+    void flushIfFull();
+    void flush();
+
+private:
+    void reserve(size_t length);
+};
+
+/**
+ * Code is flushed in blocks of about this size
+ * */
+static const size_t flushSize = 1 << 20;
+
+IREmitter::IREmitter(ostream &_output) : output(_output)
+{
+    this->tempIndex = 0;
+    this->conditionalIndex = 0;
+    this->chooseIndex = 0;
+    this->divisionIndex = 0;
+    this->block = Label{"entry", -1, ""};
+    this->size = 0;
+    this->capacity = 2 * flushSize;
+    this->buffer = (char *)malloc(capacity);
+}
+
+/**
+ * Writes whatever is left in the buffer
+ * */
+IREmitter::~IREmitter()
+{
+    flush();
+    free(buffer);
+}
+
+/**
+ * Makes room for length more bytes
+ * */
+void IREmitter::reserve(size_t length)
+{
+    if (size + length <= capacity)
+        return;
+
+    while (size + length > capacity)
+        capacity *= 2;
+
+    buffer = (char *)realloc(buffer, capacity);
+}
+
+IREmitter &IREmitter::operator<<(const char *text)
+{
+    size_t length = strlen(text);
+    reserve(length);
+    memcpy(buffer + size, text, length);
+    size += length;
+    return *this;
+}
+
+IREmitter &IREmitter::operator<<(char character)
+{
+    reserve(1);
+    buffer[size++] = character;
+    return *this;
+}
+
+/**
+ * Formats the number without going through a string
+ * */
+IREmitter &IREmitter::operator<<(int number)
+{
+    char digits[12];
+    int count = 0;
+    unsigned absolute = number < 0 ? 0u - (unsigned)number : (unsigned)number;
+
+    do
+    {
+        digits[count++] = '0' + absolute % 10;
+        absolute /= 10;
+    } while (absolute != 0);
+
+    reserve(count + 1);
+
+    if (number < 0)
+        buffer[size++] = '-';
+
+    while (count > 0)
+        buffer[size++] = digits[--count];
+
+    return *this;
+}
+
+IREmitter &IREmitter::operator<<(Value value)
+{
+    if (value.temporary)
+        *this << "%temp_var";
+
+    return *this << value.number;
+}
+
+IREmitter &IREmitter::operator<<(const Label &label)
+{
+    *this << label.kind;
+
+    if (label.index >= 0)
+        *this << '_' << label.index;
+
+    return *this << label.part;
+}
+
+/**
+ * Returns a new temporary for the result of an instruction
+ * */
+Value IREmitter::temporary()
+{
+    return Value{true, tempIndex++};
+}
+
+/**
+ * Returns the current position, code written after it can be moved with moveTo()
+ * */
+size_t IREmitter::mark()
+{
+    return size;
+}
+
+/**
+ * Moves the code written since start in front of the code written since mark.
+ * Used to put phi nodes at the start of a block after the code of the block is generated
+ * */
+void IREmitter::moveTo(size_t mark, size_t start)
+{
+    rotate(buffer + mark, buffer + start, buffer + size);
+}
+
+/**
+ * Writes the buffer to the output once it holds a block's worth of code. Only called between
+ * top level statements, so positions returned by mark() stay valid while a statement is generated
+ * */
+void IREmitter::flushIfFull()
+{
+    if (size >= flushSize)
+        flush();
+}
+
+void IREmitter::flush()
+{
+    output.write(buffer, size);
+    size = 0;
+}
@@ -0,0 +1,153 @@
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace std;
+
+/**
+ * Returns the milliseconds passed since start
+ * */
+static double elapsedMs(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Compiles the given IR code in this process with ORC LLJIT instead of writing it to a file and
+ * starting lli. The module is parsed from memory and @main is looked up, which compiles it.
+ * printf is resolved to printFunction, or to the printf of this process if it is NULL. Time spent
+ * on every phase is appended to timings.
+ * Returns the JIT holding the code, which releaseJIT() frees, and stores the address of @main in
+ * mainFunction. Returns NULL if the module can not be loaded.
+ * */
+extern "C" void *compileJIT(const string &ir, void *printFunction, int (**mainFunction)(), vector<pair<string, double>> &timings)
+{
+    auto start = chrono::steady_clock::now();
+
+    //The targets are registered once, even when several threads compile at the same time
+    static once_flag targetsInitialized;
+    call_once(targetsInitialized, []() {
+        llvm::InitializeNativeTarget();
+        llvm::InitializeNativeTargetAsmPrinter();
+    });
+
+    //Parses the IR code from memory
+    auto context = std::make_unique<llvm::LLVMContext>();
+    llvm::SMDiagnostic diagnostic;
+    std::unique_ptr<llvm::Module> module = llvm::parseAssembly(llvm::MemoryBufferRef(ir, "division-interpreter"), diagnostic, *context);
+
+    if (!module)
+    {
+        diagnostic.print("division-interpreter", llvm::errs());
+        return NULL;
+    }
+
+    timings.push_back(make_pair("IR load", elapsedMs(start)));
+    start = chrono::steady_clock::now();
+
+    //Creates the JIT and lets it resolve printf from this process
+    auto jit = llvm::orc::LLJITBuilder().create();
+
+    if (!jit)
+    {
+        llvm::logAllUnhandledErrors(jit.takeError(), llvm::errs(), "division-interpreter: ");
+        return NULL;
+    }
+
+    llvm::orc::JITDylib &library = (*jit)->getMainJITDylib();
+
+    if (printFunction != NULL)
+    {
+        llvm::orc::SymbolMap symbols;
+        symbols[(*jit)->mangleAndIntern("printf")] =
+            llvm::JITEvaluatedSymbol(llvm::pointerToJITTargetAddress(printFunction), llvm::JITSymbolFlags::Exported);
+
+        llvm::Error error = library.define(llvm::orc::absoluteSymbols(std::move(symbols)));
+
+        if (error)
+        {
+            llvm::logAllUnhandledErrors(std::move(error), llvm::errs(), "division-interpreter: ");
+            return NULL;
+        }
+    }
+
+    auto generator = llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess((*jit)->getDataLayout().getGlobalPrefix());
+
+    if (!generator)
+    {
+        llvm::logAllUnhandledErrors(generator.takeError(), llvm::errs(), "division-interpreter: ");
+        return NULL;
+    }
+
+    library.addGenerator(std::move(*generator));
+
+    llvm::Error error = (*jit)->addIRModule(llvm::orc::ThreadSafeModule(std::move(module), std::move(context)));
+
+    if (error)
+    {
+        llvm::logAllUnhandledErrors(std::move(error), llvm::errs(), "division-interpreter: ");
+        return NULL;
+    }
+
+    timings.push_back(make_pair("JIT setup", elapsedMs(start)));
+    start = chrono::steady_clock::now();
+
+    //Looking up @main compiles the module
+    auto mainSymbol = (*jit)->lookup("main");
+
+    if (!mainSymbol)
+    {
+        llvm::logAllUnhandledErrors(mainSymbol.takeError(), llvm::errs(), "division-interpreter: ");
+        return NULL;
+    }
+
+    timings.push_back(make_pair("JIT compile", elapsedMs(start)));
+
+    *mainFunction = (int (*)())mainSymbol->getAddress();
+    return jit->release();
+}
+
+/**
+ * Frees a JIT returned by compileJIT() and the code it holds
+ * */
+extern "C" void releaseJIT(void *jit)
+{
+    delete (llvm::orc::LLJIT *)jit;
+}
+
+/**
+ * Executes the given IR code in this process with the JIT. Time spent on every phase is appended to timings.
+ * Returns the value returned by @main, or 1 if the module can not be loaded.
+ * */
+extern "C" int runJIT(const string &ir, vector<pair<string, double>> &timings)
+{
+    int (*mainFunction)();
+    void *jit = compileJIT(ir, NULL, &mainFunction, timings);
+
+    if (jit == NULL)
+        return 1;
+
+    auto start = chrono::steady_clock::now();
+
+    int result = mainFunction();
+    fflush(stdout);
+
+    timings.push_back(make_pair("execute", elapsedMs(start)));
+
+    releaseJIT(jit);
+    return result;
+}
@@ -0,0 +1,48 @@
+#include <string>
+
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace std;
+
+/**
+ * Converts the given IR code to LLVM bitcode, which lli and llc load much faster than the
+ * textual form. The IR code is parsed from memory and written with the bitcode writer.
+ * Returns 0, or 1 if the IR code can not be parsed.
+ * */
+extern "C" int writeBitcode(const string &ir, string &bitcode)
+{
+    llvm::LLVMContext context;
+    llvm::SMDiagnostic diagnostic;
+
+    std::unique_ptr<llvm::Module> module = llvm::parseAssembly(llvm::MemoryBufferRef(ir, "division-interpreter"), diagnostic, context);
+
+    if (!module)
+    {
+        diagnostic.print("division-interpreter", llvm::errs());
+        return 1;
+    }
+
+    //Names of temporaries and labels are only there for reading, without them the bitcode is smaller and loads faster
+    for (llvm::Function &function : *module)
+    {
+        for (llvm::BasicBlock &block : function)
+        {
+            for (llvm::Instruction &instruction : block)
+                instruction.setName("");
+
+            block.setName("");
+        }
+    }
+
+    llvm::raw_string_ostream output(bitcode);
+    llvm::WriteBitcodeToFile(*module, output);
+    output.flush();
+
+    return 0;
+}
@@ -0,0 +1,125 @@
+#include <string>
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/MC/SubtargetFeature.h"
+#include "llvm/MC/TargetRegistry.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetOptions.h"
+
+using namespace std;
+
+/**
+ * Returns the features of the processor this runs on, like +avx2
+ * */
+static string hostFeatures()
+{
+    llvm::SubtargetFeatures features;
+    llvm::StringMap<bool> hostFeatures;
+
+    if (llvm::sys::getHostCPUFeatures(hostFeatures))
+    {
+        for (auto &feature : hostFeatures)
+            features.AddFeature(feature.first(), feature.second);
+    }
+
+    return features.getString();
+}
+
+/**
+ * Compiles the given IR code to a native object file for this machine. Levels 1 to 3 run the
+ * optimization pipeline of clang -O1 to -O3 before code generation, the code generator uses
+ * the same level. The object only needs printf from the C library.
+ * Returns 0, or 1 if the IR code can not be parsed or the object can not be written.
+ * */
+extern "C" int writeObject(const string &ir, int level, const string &path)
+{
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+
+    llvm::LLVMContext context;
+    llvm::SMDiagnostic diagnostic;
+    std::unique_ptr<llvm::Module> module = llvm::parseAssembly(llvm::MemoryBufferRef(ir, "division-interpreter"), diagnostic, context);
+
+    if (!module)
+    {
+        diagnostic.print("division-interpreter", llvm::errs());
+        return 1;
+    }
+
+    //Creates the target machine for this processor
+    string triple = llvm::sys::getDefaultTargetTriple();
+    string error;
+    const llvm::Target *target = llvm::TargetRegistry::lookupTarget(triple, error);
+
+    if (target == NULL)
+    {
+        llvm::errs() << "division-interpreter: " << error << "\n";
+        return 1;
+    }
+
+    static const llvm::CodeGenOpt::Level codeGenLevels[] = {llvm::CodeGenOpt::None, llvm::CodeGenOpt::Less,
+                                                            llvm::CodeGenOpt::Default, llvm::CodeGenOpt::Aggressive};
+
+    std::unique_ptr<llvm::TargetMachine> machine(target->createTargetMachine(triple, llvm::sys::getHostCPUName(), hostFeatures(),
+                                                                             llvm::TargetOptions(), llvm::Reloc::PIC_, llvm::None,
+                                                                             codeGenLevels[level]));
+
+    module->setTargetTriple(triple);
+    module->setDataLayout(machine->createDataLayout());
+
+    //Optimizes the module with the standard pipeline of the level
+    if (level > 0)
+    {
+        static const llvm::OptimizationLevel optimizationLevels[] = {llvm::OptimizationLevel::O0, llvm::OptimizationLevel::O1,
+                                                                     llvm::OptimizationLevel::O2, llvm::OptimizationLevel::O3};
+
+        llvm::LoopAnalysisManager loops;
+        llvm::FunctionAnalysisManager functions;
+        llvm::CGSCCAnalysisManager callGraph;
+        llvm::ModuleAnalysisManager modules;
+        llvm::PassBuilder builder(machine.get());
+
+        builder.registerModuleAnalyses(modules);
+        builder.registerCGSCCAnalyses(callGraph);
+        builder.registerFunctionAnalyses(functions);
+        builder.registerLoopAnalyses(loops);
+        builder.crossRegisterProxies(loops, functions, callGraph, modules);
+
+        llvm::ModulePassManager passes = builder.buildPerModuleDefaultPipeline(optimizationLevels[level]);
+        passes.run(*module, modules);
+    }
+
+    //Writes the object file
+    std::error_code errorCode;
+    llvm::raw_fd_ostream output(path, errorCode, llvm::sys::fs::OF_None);
+
+    if (errorCode)
+    {
+        llvm::errs() << "division-interpreter: can not write " << path << ": " << errorCode.message() << "\n";
+        return 1;
+    }
+
+    llvm::legacy::PassManager codeGenerator;
+
+    if (machine->addPassesToEmitFile(codeGenerator, output, nullptr, llvm::CGFT_ObjectFile))
+    {
+        llvm::errs() << "division-interpreter: the target can not write object files\n";
+        return 1;
+    }
+
+    codeGenerator.run(*module);
+    output.flush();
+
+    return 0;
+}
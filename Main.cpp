@@ -1,11 +1,85 @@
 #include <fstream>
 #include <string>
-#include <unordered_set>
+#include <unordered_map>
 #include <vector>
+#include <type_traits>
+#include <utility>
+#include <new>
 #include <iostream>
+#include <sstream>
+#include <chrono>
+#include <iomanip>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <algorithm>
+#include <spawn.h>
+#include <sys/wait.h>
 using namespace std;
 
 
+/**
+ * Memory for everything created during one compilation: AST nodes and their strings.
+ * Memory is handed out from large blocks and released all at once by reset() or the destructor,
+ * objects that need a destructor call (like the statement vector of ConditionalNode) are
+ * remembered and destroyed at that point.
+ * */
+class Arena
+{
+public:
+    struct Cleanup
+    {
+        void (*destroy)(void *object);
+        void *object;
+        Cleanup *next;
+    };
+
+    vector<pair<char *, size_t>> blocks;
+    char *position; //free part of the current block
+    char *limit;
+    size_t blockSize;
+    Cleanup *cleanups;
+
+    size_t allocations;
+    size_t bytesAllocated; //bytes handed out since the last reset
+    size_t peakBytes;      //largest value of bytesAllocated
+    size_t bytesReserved;  //size of all blocks
+
+    Arena(size_t _blockSize = 1 << 16);
+    ~Arena();
+
+    void *allocate(size_t size, size_t alignment = alignof(void *));
+    const char *copyString(const string &text);
+    void reset();
+
+    /**
+     * Creates an object in the arena
+     * */
+    template <typename T, typename... Args>
+    T *make(Args &&... args)
+    {
+        T *object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+
+        if (!is_trivially_destructible<T>::value)
+        {
+            Cleanup *cleanup = (Cleanup *)allocate(sizeof(Cleanup), alignof(Cleanup));
+            cleanup->destroy = [](void *object) { ((T *)object)->~T(); };
+            cleanup->object = object;
+            cleanup->next = cleanups;
+            cleanups = cleanup;
+        }
+
+        return object;
+    }
+};
+
 enum TokenType
 {
     token_identifier,
@@ -18,33 +92,166 @@ enum TokenType
     token_eof
 };
 
+/**
+ * Operator tokens, the value of each operator is its character
+ * */
+enum OperatorType : char
+{
+    operator_plus = '+',
+    operator_minus = '-',
+    operator_multiply = '*',
+    operator_divide = '/',
+    operator_assign = '=',
+    operator_comma = ',',
+    operator_open_paren = '(',
+    operator_close_paren = ')',
+    operator_open_brace = '{',
+    operator_close_brace = '}'
+};
+
 struct Token
 {
-    string value;
     TokenType type;
     int line;
+    union
+    {
+        OperatorType op; //token_operator, any other character is stored as it is
+        int symbol;      //token_identifier, index of the name in the symbol table
+        int number;      //token_number, value of the literal truncated to i32
+        int conditional; //token_conditional, 0 for if and 1 for while
+    };
+};
+
+/**
+ * Interns identifiers. Every distinct name gets the next symbol index and is stored once in the arena,
+ * the hash table is looked up with the characters in the input buffer so no string is created.
+ * */
+class SymbolTable
+{
+public:
+    Arena *arena;
+    vector<const char *> names;
+    vector<unsigned> hashes;
+    vector<int> lengths;
+    vector<int> table; //open addressing, holds symbol indexes or -1
+
+    SymbolTable(Arena *_arena);
+
+    int intern(const char *text, int length);
+};
+
+/**
+ * Contents of an input file in one contiguous block of memory. Regular files are memory mapped,
+ * other inputs like pipes are read into a buffer with large reads.
+ * */
+class InputBuffer
+{
+public:
+    const char *data;
+    size_t size;
+    bool mapped;
+    char *buffer; //allocated when the input is not mapped
+    bool error;
+    size_t released; //bytes at the start given back by release()
+
+    InputBuffer(string fileName);
+    ~InputBuffer();
+
+    void release(const char *position);
 };
 
 class Tokenizer
 {
 public:
-    ifstream *inputFile;
+    const char *cursor; //next character to read
+    const char *end;
+    bool eof;           //set when a character is read past the end of the input
     char lastChar;
     int line;
 
-    Tokenizer(ifstream *inputFile);
-    ~Tokenizer();
+    SymbolTable symbols;
+
+    Tokenizer(const char *input, size_t size, Arena *arena);
 
-    // void tokenizeInput(ifstream &input);
+    void nextChar();
     Token getNextToken();
 };
 
+class BytecodeCompiler;
+class Columns;
+
+// Result of the code generation of an expression: an integer constant or the number of a temporary
+struct Value
+{
+    bool temporary;
+    int number;
+};
+
+// Name of a basic block, written as <kind>_<index><part> like cond_3body.
+// Labels with a negative index are written as <kind> only
+struct Label
+{
+    const char *kind;
+    int index;
+    const char *part;
+};
+
+// Reciprocal of a divisor that does not change in a while loop, calculated in front of the loop
+struct Reciprocal
+{
+    Value divisor;    //the divisor it belongs to
+    Value multiplier; //i128, ceil(2^64 / |divisor|)
+    Value usable;     //i1, false for the divisors 0, 1 and -1, which are divided with sdiv
+};
+
+// Writes IR code into a growing byte buffer instead of streaming every fragment separately.
+// Numbers and temporaries are formatted straight into the buffer, the buffer is written to
+// the output in large blocks by flushIfFull() and flush()
+class IREmitter
+{
+public:
+    ostream &output;
+    char *buffer;
+    size_t size;
+    size_t capacity;
+
+    //State of the code generation of one program
+    int tempIndex;                       //number of the next temporary
+    int conditionalIndex;                //number of the next if/while, used in its labels
+    int chooseIndex;                     //number of the next choose, used in its labels
+    int divisionIndex;                   //number of the next division by a reciprocal, used in its labels
+    vector<Value> values;                //SSA value of every variable slot at the current point of code generation
+    unordered_map<int, Reciprocal> reciprocals; //reciprocals of the divisors of the loops being generated, by slot
+    Label block;                         //label of the basic block code is being generated into
+
+    IREmitter(ostream &_output);
+    ~IREmitter();
+
+    IREmitter &operator<<(const char *text);
+    IREmitter &operator<<(char character);
+    IREmitter &operator<<(int number);
+    IREmitter &operator<<(Value value);
+    IREmitter &operator<<(const Label &label);
+
+    Value temporary();
+    size_t mark();
+    void moveTo(size_t mark, size_t start);
+    void flushIfFull();
+    void flush();
+
+private:
+    void reserve(size_t length);
+};
+
 // Abstract class for Asynchronous Syntax Tree
 class ASTNode
 {
 public:
-    static int tempIndex;
-    virtual string generateCode(ofstream &output) = 0;
+    virtual Value generateCode(IREmitter &output) = 0;
+    virtual int evaluate(vector<int> &variables) = 0;
+    virtual int compile(BytecodeCompiler &compiler, int target) = 0;
+    virtual ASTNode *fold(Arena &arena) = 0;
+    virtual const int *evaluateColumns(Columns &columns, const int *mask) = 0;
  };
 
 
@@ -52,9 +259,14 @@ public:
 class IdentifierNode : public ASTNode
 {
 public:
-    string name;
-    IdentifierNode(string _name);
-    string generateCode(ofstream &output);
+    const char *name;
+    int slot; //index of the variable in Parser::variables and in the variables of every backend
+    IdentifierNode(const char *_name, int _slot);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
     string getID();
 };
 
@@ -65,9 +277,13 @@ public:
 class NumberNode : public ASTNode
 {
 public:
-    string value;
-    NumberNode(string _value);
-    string generateCode(ofstream &output);
+    int value;
+    NumberNode(int _value);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
 };
 
 
@@ -78,9 +294,12 @@ class ChooseNode : public ASTNode
 {
 public:
     ASTNode *expr1, *expr2, *expr3, *expr4;
-    static int chooseIndex;
     ChooseNode(ASTNode *_expr1, ASTNode *_expr2, ASTNode *_expr3, ASTNode *_expr4);
-    string generateCode(ofstream &output);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
 };
 
 // Node for binary operations. Stores the operation type, right and left handside as expressions
@@ -94,7 +313,45 @@ public:
     char operation;
 
     BinaryOperationNode(ASTNode *_left, ASTNode *_right, char _operation);
-    string generateCode(ofstream &output);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+// Node for division by a constant divisor, fold() creates it from BinaryOperationNode.
+// The division is calculated with a multiplication and shifts instead of a division instruction
+
+class ConstantDivisionNode : public ASTNode
+{
+public:
+    ASTNode *dividend;
+    int divisor;    //anything but 0, 1 and -1
+    int multiplier; //0 if the absolute value of divisor is a power of two
+    int shift;
+
+    ConstantDivisionNode(ASTNode *_dividend, int _divisor);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node for a division that always traps, by zero or INT_MIN / -1. fold() creates it from
+ * BinaryOperationNode, the operands are dropped since the division traps whatever they calculate
+ * */
+class TrapNode : public ASTNode
+{
+public:
+    TrapNode();
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
 };
 
 // Node for print statements. Generates code for print statement and expression inside the statement
@@ -104,7 +361,11 @@ class PrintNode : public ASTNode
 public:
     ASTNode *expr;
     PrintNode(ASTNode *_expr);
-    string generateCode(ofstream &output);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
 };
 
 // Node to store conditional statements. Stores the condition, conditional type and statements
@@ -113,13 +374,16 @@ public:
 class ConditionalNode : public ASTNode
 {
 public:
-    static int conditionalIndex;
     int type;
     ASTNode *condition;
     vector<ASTNode *> statements;
 
     ConditionalNode(int _type, ASTNode *_condition);
-    string generateCode(ofstream &output);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
 };
 
 /**
@@ -132,105 +396,432 @@ public:
     IdentifierNode *identifier;
     ASTNode *expr;
     AssignNode(IdentifierNode *id, ASTNode *expr);
-    string generateCode(ofstream &output);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
 };
 
 class Parser
 {
 public:
     Tokenizer *tokenizer;
+    Arena *arena; //owns all nodes created by the parser
     int line, errLine;
     bool error;
-    unordered_set<string> variables;
+    vector<string> variables; //declared variables in the order they first appear, their index is their slot
+    vector<int> slots;        //slot of every symbol, -1 for symbols that are not declared yet
     Token currentToken, lastToken;
 
-    Parser(Tokenizer *_tokenizer);
+    Parser(Tokenizer *_tokenizer, Arena *_arena);
 
     ASTNode *parseParanExpr();
-    ASTNode *parseFactor();
-    ASTNode *parseMorefactor();
-    ASTNode *parseTerm();
     ASTNode *parsePrint();
-    ASTNode *parseChoose();
-    ASTNode *parseMoreterms();
     ASTNode *parseExpr();
     ASTNode *parseStatement();
     ASTNode *parse();
 
     void syntaxError(int line);
     Token getToken();
+    bool isOperator(OperatorType op);
+    int declare(int symbol);
 };
 
+// Directory of compiled programs (IR code or bytecode). Every entry is stored under a hash of the
+// source text, the compiler and the options it was compiled with, so a program that did not change
+// is read back from the cache without tokenizing and parsing it again.
+class Cache
+{
+public:
+    string directory;
+    string compiler; //identifies the executable, entries of another build are never used
+
+    Cache(const string &_directory);
+
+    string key(const char *source, size_t size, const string &options);
+    bool load(const string &key, const char *kind, string &contents);
+    void store(const string &key, const char *kind, const string &contents);
+};
+
+void syntaxError(int line, ostream &output);
+void generateIR(ostream &file, vector<ASTNode *> &program, vector<string> &varmap);
+void generateHeader(IREmitter &output);
+void generateFooter(IREmitter &output);
+
+void foldConstants(vector<ASTNode *> &program, Arena &arena);
+void numberValues(vector<ASTNode *> &program, vector<string> &variables, Arena &arena);
+void removeDeadStores(vector<ASTNode *> &program, vector<string> &variables);
+
+class Bytecode;
+
+Bytecode *compileBytecode(vector<ASTNode *> &program, vector<string> &variables);
+void runBytecode(Bytecode *bytecode);
+void disassembleBytecode(Bytecode *bytecode, ostream &output);
+void saveBytecode(Bytecode *bytecode, string &output);
+Bytecode *loadBytecode(const string &data);
+
+int runColumns(vector<ASTNode *> &program, vector<string> &variables, const string &fileName, bool scalar);
+
+int runServer(const string &path, int jobs, int timeLimit);
+int runClient(const string &path, const string &engine, const string &inputFile, bool stats);
+
+typedef int (*RunJITFunction)(const string &ir, vector<pair<string, double>> &timings);
+typedef int (*WriteBitcodeFunction)(const string &ir, string &bitcode);
+typedef int (*WriteObjectFunction)(const string &ir, int level, const string &path);
+
 /**
- * Creates the code for syntax error in given line
+ * Returns the milliseconds passed since start
  * */
-void syntaxError(int line, ofstream &output)
-{
-    output << "; ModuleID = \'division-interpreter\'\n"
-           << "declare i32 @printf(i8*, ...)\n"
-           << "@print.str = constant [23 x i8] c\"Line %d: syntax error\\0A\\00\"\n\n"
-           << "define i32 @main() {\n"
-           << "\tcall i32 (i8*, ...)* @printf(i8* getelementptr ([23 x i8]* @print.str, i32 0, i32 0), i32 " << line << ")\n"
-           << "\tret i32 0\n"
-           << "}";
+double elapsedMs(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+/****************
+ * Profiling
+ * **************/
+
+//One timed phase of a run
+struct Phase
+{
+    string name;
+    string detail;     //shown in the trace, like the file a batch thread compiles
+    int thread;        //0 for the main thread, the threads of --batch are numbered from 1
+    int depth;         //number of phases it is nested in
+    double start;      //ms since the run started
+    double duration;   //ms
+    long long allocations; //allocations and bytes the phase took from the arena of the program, -1 if it has none
+    long long bytes;
+};
+
+// Collects the phases of a run. When the run is over, the destructor prints the summary of the phases to
+// stderr (--time-report and --run) and writes them as a Chrome trace event file (--trace=FILE)
+class Profiler
+{
+public:
+    chrono::steady_clock::time_point origin;
+    bool report;
+    string traceFile;
+    vector<Phase> phases;
+    mutex lock;
+
+    Profiler(bool _report, const string &_traceFile);
+    ~Profiler();
+
+    double now();
+    void add(const Phase &phase);
+    void addTimings(vector<pair<string, double>> &timings, double start, int depth);
+    void printReport(ostream &output);
+    void writeTrace(ostream &output);
+};
+
+// Times the phase from its construction to end() or its destruction, does nothing when nothing is profiled.
+// Phases that build the AST count what they take from its arena, the counters of the arena are read at
+// both ends so nothing is counted while no phase runs
+class ScopedPhase
+{
+public:
+    Phase phase;
+    bool running;
+    Arena *arena;
+    size_t allocationsAtStart;
+    size_t bytesAtStart;
+
+    ScopedPhase(const char *name, const string &detail = "", Arena *_arena = NULL);
+    ~ScopedPhase();
+
+    void end();
+};
+
+Profiler *profiler = NULL; //set while --time-report, --trace or --run profile the run
+
+static atomic<int> threadCount(0);
+static thread_local int threadNumber = -1;
+static thread_local int phaseDepth = 0; //phases running on the current thread
+
+Profiler::Profiler(bool _report, const string &_traceFile)
+{
+    this->origin = chrono::steady_clock::now();
+    this->report = _report;
+    this->traceFile = _traceFile;
+}
+
+Profiler::~Profiler()
+{
+    if (report)
+        printReport(cerr);
+
+    if (traceFile != "")
+    {
+        ofstream output(traceFile);
+        writeTrace(output);
+
+        if (!output)
+            cerr << "division-interpreter: can not write " << traceFile << "\n";
+    }
 }
 
 /**
- * Generates IR code by adding headers to file, allocating space for all variables 
- * and running generateCode() function from AST nodes which creates IR code for its type.
- * Takes parameters ofstream output to print to file, vector<ASTNode> program is the AST
- * and varmap stores all the declared variables which is used to allocate them.
+ * Returns the milliseconds passed since the run started
  * */
-void generateIR(ofstream &output, vector<ASTNode *> &program, unordered_set<string> &varmap)
+double Profiler::now()
 {
+    return elapsedMs(origin);
+}
 
-    //Adding header to .ll file
-    output << "; ModuleID = \'division-interpreter\'\n"
-           << "declare i32 @printf(i8*, ...)\n"
-           << "@print.str = constant [4 x i8] c\"%d\\0A\\00\"\n\n"
-           << "define i32 @main() {\n";
+void Profiler::add(const Phase &phase)
+{
+    lock_guard<mutex> guard(lock);
+    phases.push_back(phase);
+}
 
-    //Allocates declared variables
-    for (auto test : varmap)
+/**
+ * Adds the phases timed by the LLVM backend, which only reports how long each phase took.
+ * They are placed one after the other from start
+ * */
+void Profiler::addTimings(vector<pair<string, double>> &timings, double start, int depth)
+{
+    for (auto &timing : timings)
     {
-        output << "\t%" << test << " = alloca i32\n";
+        add(Phase{timing.first, "", threadNumber, depth, start, timing.second, -1, -1});
+        start += timing.second;
     }
+}
 
-    output << "\n";
+/**
+ * Prints a table of the phases, phases with the same name and nesting are added up into one line
+ * in the order they first started. Nested phases are indented below the phase they ran in
+ * */
+void Profiler::printReport(ostream &output)
+{
+    struct Total
+    {
+        string name;
+        int depth;
+        int calls;
+        double duration;
+        long long allocations, bytes;
+    };
+
+    vector<Phase> sorted = phases;
+    vector<Total> totals;
 
-    //Gives all allocated vars value of 0
-    for (auto identifier : varmap)
+    stable_sort(sorted.begin(), sorted.end(), [](const Phase &a, const Phase &b) { return a.start < b.start; });
+
+    for (auto &phase : sorted)
     {
-        output << "\tstore i32 0, i32* %" << identifier << "\n";
+        auto total = find_if(totals.begin(), totals.end(), [&](const Total &total) {
+            return total.name == phase.name && total.depth == phase.depth;
+        });
+
+        if (total == totals.end())
+            total = totals.insert(totals.end(), Total{phase.name, phase.depth, 0, 0, phase.allocations < 0 ? -1 : 0, 0});
+
+        total->calls++;
+        total->duration += phase.duration;
+
+        if (total->allocations >= 0 && phase.allocations >= 0)
+        {
+            total->allocations += phase.allocations;
+            total->bytes += phase.bytes;
+        }
     }
 
-    output << "\n";
+    output << left << setw(24) << "phase" << right << setw(8) << "calls" << setw(12) << "ms" << setw(14) << "allocations"
+           << setw(14) << "bytes" << "\n";
 
-    //Creates the code from given program
-    for (auto expression : program)
+    for (auto &total : totals)
     {
-        expression->generateCode(output);
+        output << left << setw(24) << string(2 * total.depth, ' ') + total.name << right << setw(8) << total.calls
+               << setw(12) << fixed << setprecision(3) << total.duration;
+
+        if (total.allocations >= 0)
+            output << setw(14) << total.allocations << setw(14) << total.bytes << "\n";
+        else
+            output << setw(14) << "-" << setw(14) << "-" << "\n";
     }
 
-    //Finishes the code creation
-    output << "\tret i32 0\n"
-           << "}";
+    output << left << setw(24) << "total" << setw(8) << "" << right << setw(12) << now() << "\n";
 }
 
-int main(int argc, char *argv[])
+/**
+ * Writes the text with the characters JSON strings can not hold escaped
+ * */
+static void writeJSONString(ostream &output, const string &text)
 {
+    output << '"';
 
-    vector<ASTNode *> program; //vector to hold Nodes for code generation
+    for (char character : text)
+    {
+        if (character == '"' || character == '\\')
+            output << '\\' << character;
+        else if ((unsigned char)character < 0x20)
+            output << "\\u" << hex << setw(4) << setfill('0') << (int)character << dec << setfill(' ');
+        else
+            output << character;
+    }
+
+    output << '"';
+}
 
-    string inputFile = argv[1]; 
-    string outputFile = inputFile.substr(0, inputFile.size() - 3) + ".ll";
+/**
+ * Writes the phases in the trace event format of chrome://tracing and Perfetto, one complete
+ * event ("ph":"X") per phase with its time in microseconds and its allocations as arguments
+ * */
+void Profiler::writeTrace(ostream &output)
+{
+    output << "{\"traceEvents\":[";
 
-    ifstream inFile(inputFile);
+    for (size_t i = 0; i < phases.size(); i++)
+    {
+        Phase &phase = phases[i];
 
-    Tokenizer *tokenizer = new Tokenizer(&inFile);
-    Parser *parser = new Parser(tokenizer);
+        output << (i > 0 ? ",\n" : "\n") << "{\"name\":";
+        writeJSONString(output, phase.name);
+        output << ",\"cat\":\"phase\",\"ph\":\"X\",\"ts\":" << fixed << setprecision(3) << phase.start * 1000
+               << ",\"dur\":" << phase.duration * 1000 << ",\"pid\":" << getpid() << ",\"tid\":" << phase.thread << ",\"args\":{";
+
+        if (phase.allocations >= 0)
+            output << "\"allocations\":" << phase.allocations << ",\"bytes\":" << phase.bytes << (phase.detail != "" ? "," : "");
+
+        if (phase.detail != "")
+        {
+            output << "\"file\":";
+            writeJSONString(output, phase.detail);
+        }
+
+        output << "}}";
+    }
+
+    output << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+ScopedPhase::ScopedPhase(const char *name, const string &detail, Arena *_arena)
+{
+    this->running = profiler != NULL;
+    this->arena = _arena;
+
+    if (!running)
+        return;
+
+    if (threadNumber < 0)
+        threadNumber = threadCount++;
+
+    phase.name = name;
+    phase.detail = detail;
+    phase.thread = threadNumber;
+    phase.depth = phaseDepth++;
+    phase.start = profiler->now();
+    this->allocationsAtStart = arena != NULL ? arena->allocations : 0;
+    this->bytesAtStart = arena != NULL ? arena->bytesAllocated : 0;
+}
+
+ScopedPhase::~ScopedPhase()
+{
+    end();
+}
+
+void ScopedPhase::end()
+{
+    if (!running)
+        return;
+
+    running = false;
+    phaseDepth--;
+    phase.duration = profiler->now() - phase.start;
+    phase.allocations = arena != NULL ? (long long)(arena->allocations - allocationsAtStart) : -1;
+    phase.bytes = arena != NULL ? (long long)(arena->bytesAllocated - bytesAtStart) : -1;
+    profiler->add(phase);
+}
+
+/**
+ * Returns the address of a function from the LLVM backend (division-llvm.so next to the executable).
+ * The backend is loaded on first use so the runs that don't need LLVM don't pay for loading it.
+ * Exits if the backend can not be loaded.
+ * */
+void *llvmBackend(const char *name)
+{
+    static void *library = NULL;
+
+    if (library == NULL)
+    {
+        ScopedPhase phase("load LLVM backend");
+        char path[4096];
+        ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+        string directory = length > 0 ? string(path, length) : string("./division-interpreter");
+        directory = directory.substr(0, directory.rfind('/') + 1);
+
+        library = dlopen((directory + "division-llvm.so").c_str(), RTLD_NOW | RTLD_LOCAL);
+
+        if (library == NULL)
+        {
+            cerr << "division-interpreter: can not load the LLVM backend: " << dlerror() << "\n";
+            exit(1);
+        }
+    }
+
+    void *function = dlsym(library, name);
+
+    if (function == NULL)
+    {
+        cerr << "division-interpreter: " << dlerror() << "\n";
+        exit(1);
+    }
+
+    return function;
+}
+
+/**
+ * Compiles the IR code to a native object file with the LLVM backend and links it to an executable
+ * with the C compiler, which also provides printf. Returns false if either step fails
+ * */
+bool buildExecutable(const string &ir, int level, const string &executable)
+{
+    string object = executable + ".o";
+    WriteObjectFunction writeObject = (WriteObjectFunction)llvmBackend("writeObject");
+    ScopedPhase objectPhase("write object");
+
+    if (writeObject(ir, level, object) != 0)
+        return false;
+
+    objectPhase.end();
+
+    ScopedPhase linkPhase("link");
+    const char *arguments[] = {"cc", "-o", executable.c_str(), object.c_str(), NULL};
+    pid_t process;
+    int status;
+
+    bool linked = posix_spawnp(&process, "cc", NULL, NULL, (char **)arguments, environ) == 0 &&
+                  waitpid(process, &status, 0) == process && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+
+    unlink(object.c_str());
+
+    if (!linked)
+        cerr << "division-interpreter: can not link " << executable << "\n";
+
+    return linked;
+}
+
+/**
+ * Parses statements till there is an error or it is end of file
+ * */
+void parseProgram(Parser *parser, vector<ASTNode *> &program)
+{
+    //The parser tokenizes as it goes, when profiling the time of the tokenizer alone is measured with a separate pass
+    if (profiler != NULL)
+    {
+        Arena arena;
+        ScopedPhase phase("tokenize", "", &arena);
+        Tokenizer tokenizer(parser->tokenizer->cursor, parser->tokenizer->end - parser->tokenizer->cursor, &arena);
+
+        while (tokenizer.getNextToken().type != token_eof)
+        {
+        }
+    }
+
+    ScopedPhase phase("parse", "", parser->arena);
 
-    //Parse till there is an error or it is end of file
     while (!parser->error && parser->currentToken.type != token_eof)
     {
 
@@ -241,22 +832,599 @@ int main(int argc, char *argv[])
         else
             break;
     }
+}
 
-    inFile.close();
+/**
+ * Returns the name of the output file, the input file with .bc for bitcode or .ll for IR code
+ * */
+string outputName(const string &inputFile, bool bitcode)
+{
+    return inputFile.substr(0, inputFile.size() - 3) + (bitcode ? ".bc" : ".ll");
+}
+
+/**
+ * Writes a parsed program to the output file as bitcode or as IR code, and a copy to the cache
+ * if there is one. IR code that is not kept anywhere else is written straight to the file
+ * */
+void writeProgram(const string &outputFile, Parser *parser, vector<ASTNode *> &program, bool bitcode, Cache *cache, const string &key)
+{
+    ostringstream ir;
+    ofstream outFile;
+    bool direct = !bitcode && cache == NULL;
 
-    ofstream outFile(outputFile);
+    if (direct)
+        outFile.open(outputFile);
+
+    ostream &output = direct ? (ostream &)outFile : ir;
 
     //if there is an error generate error code
-    if (parser->error)
     {
-        syntaxError(parser->errLine, outFile);
+        ScopedPhase phase("generateIR");
+
+        if (parser->error)
+            syntaxError(parser->errLine, output);
+        else
+            generateIR(output, program, parser->variables);
+    }
+
+    if (direct)
+        return;
+
+    string contents = ir.str();
+
+    if (bitcode)
+    {
+        string code;
+        WriteBitcodeFunction writeBitcode = (WriteBitcodeFunction)llvmBackend("writeBitcode");
+        ScopedPhase phase("write bitcode");
+
+        if (writeBitcode(contents, code) != 0)
+            return;
+
+        contents.swap(code);
+    }
+
+    {
+        ScopedPhase phase("write file");
+        outFile.open(outputFile, ios::binary);
+        outFile.write(contents.data(), contents.size());
+        outFile.close();
+    }
+
+    if (cache != NULL)
+    {
+        ScopedPhase phase("cache store");
+        cache->store(key, bitcode ? "bc" : "ll", contents);
+    }
+}
+
+/**
+ * Compiles one input file to its .bc or .ll file like the default mode. Everything the compilation
+ * uses belongs to this call, so files can be compiled on several threads at the same time.
+ * Returns false if the input can not be read
+ * */
+bool compileFile(const string &inputFile, bool fold, bool bitcode, Cache *cache)
+{
+    ScopedPhase filePhase("compile file", inputFile);
+    ScopedPhase readPhase("read input");
+    InputBuffer input(inputFile);
+
+    readPhase.end();
+
+    if (input.error)
+        return false;
+
+    string outputFile = outputName(inputFile, bitcode);
+    const char *kind = bitcode ? "bc" : "ll";
+    string key;
+
+    //A program compiled before is copied from the cache
+    if (cache != NULL)
+    {
+        string contents;
+        ScopedPhase phase("cache load");
+        key = cache->key(input.data, input.size, string(kind) + (fold ? "" : " --no-fold"));
+
+        if (cache->load(key, kind, contents))
+        {
+            phase.end();
+            ofstream(outputFile, ios::binary).write(contents.data(), contents.size());
+            return true;
+        }
+    }
+
+    Arena arena;
+    Tokenizer tokenizer(input.data, input.size, &arena);
+    Parser parser(&tokenizer, &arena);
+    vector<ASTNode *> program;
+
+    parseProgram(&parser, program);
+
+    if (fold && !parser.error)
+    {
+        ScopedPhase phase("fold", "", &arena);
+        foldConstants(program, arena);
+        numberValues(program, parser.variables, arena);
+        removeDeadStores(program, parser.variables);
+    }
+
+    writeProgram(outputFile, &parser, program, bitcode, cache, key);
+
+    return true;
+}
+
+/**
+ * Runs the IR code with the JIT of the LLVM backend, the phases the backend times are added to the
+ * profile under the JIT phase. Returns the result of the program
+ * */
+int runProgram(const string &ir)
+{
+    RunJITFunction runJIT = (RunJITFunction)llvmBackend("runJIT");
+    vector<pair<string, double>> timings;
+    ScopedPhase phase("JIT");
+    double start = profiler != NULL ? profiler->now() : 0;
+
+    int result = runJIT(ir, timings);
+
+    if (profiler != NULL)
+        profiler->addTimings(timings, start, phaseDepth);
+
+    return result;
+}
+
+/**
+ * Prints how much memory the arena handed out
+ * */
+void printArenaStats(Arena &arena)
+{
+    cerr << "arena: " << arena.allocations << " allocations, " << arena.bytesAllocated << " bytes allocated (peak "
+         << arena.peakBytes << "), " << arena.bytesReserved << " bytes reserved in " << arena.blocks.size() << " blocks\n";
+}
+
+/**
+ * Compiles the input to IR code one top level statement at a time (--stream). Every statement is
+ * folded and its code generated as soon as it is parsed, then its nodes are released and the input
+ * read so far is given back, so the memory used does not grow with the length of the program. Only
+ * the names of the variables are kept, in an arena of their own. Variables are SSA values that start
+ * as 0, so nothing has to be declared in front of the code. After a syntax error the file is written
+ * again with the code for the error
+ * */
+void streamProgram(InputBuffer &input, const string &outputFile, bool fold, bool arenaStats)
+{
+    Arena names; //interned names of the variables
+    Arena nodes; //nodes of the statement being compiled
+    Tokenizer tokenizer(input.data, input.size, &names);
+    Parser parser(&tokenizer, &nodes);
+    ofstream file(outputFile);
+
+    {
+        ScopedPhase phase("stream");
+        IREmitter output(file);
+
+        generateHeader(output);
+
+        while (!parser.error && parser.currentToken.type != token_eof)
+        {
+            ASTNode *statement = parser.parse();
+
+            if (statement == NULL || parser.error)
+                break;
+
+            //Variables first seen in this statement start as 0
+            output.values.resize(parser.variables.size(), Value{false, 0});
+
+            vector<ASTNode *> statements(1, statement);
+
+            if (fold)
+                foldConstants(statements, nodes);
+
+            for (auto folded : statements)
+                folded->generateCode(output);
+
+            output.flushIfFull();
+            nodes.reset();
+            input.release(tokenizer.cursor);
+        }
+
+        generateFooter(output);
+    }
+
+    if (parser.error)
+    {
+        file.close();
+        file.open(outputFile, ios::trunc);
+        syntaxError(parser.errLine, file);
+    }
+
+    if (arenaStats)
+        printArenaStats(nodes);
+}
+
+/**
+ * Adds the file to inputs, or the .my files in it if it is a directory
+ * */
+void addInputs(const string &path, vector<string> &inputs)
+{
+    struct stat status;
+
+    if (stat(path.c_str(), &status) != 0 || !S_ISDIR(status.st_mode))
+    {
+        inputs.push_back(path);
+        return;
+    }
+
+    DIR *directory = opendir(path.c_str());
+
+    if (directory == NULL)
+        return;
+
+    vector<string> files;
+    string prefix = path.back() == '/' ? path : path + "/";
+
+    while (struct dirent *entry = readdir(directory))
+    {
+        string name = entry->d_name;
+
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, ".my") == 0)
+            files.push_back(prefix + name);
+    }
+
+    closedir(directory);
+
+    sort(files.begin(), files.end());
+    inputs.insert(inputs.end(), files.begin(), files.end());
+}
+
+/**
+ * Compiles all inputs with a pool of threads, every thread takes the next file from the list
+ * until none is left. Prints the number of files compiled per second to stderr.
+ * Returns 1 if any file could not be read
+ * */
+int compileBatch(vector<string> &inputs, int jobs, bool fold, bool bitcode, Cache *cache)
+{
+    atomic<size_t> next(0);
+    atomic<int> failed(0);
+    mutex errorLock;
+
+    //Loads the LLVM backend before the threads need it
+    if (bitcode)
+        llvmBackend("writeBitcode");
+
+    auto start = chrono::steady_clock::now();
+    ScopedPhase phase("batch");
+    int depth = phaseDepth;
+
+    //The phases of the other threads are nested in the batch phase too
+    auto worker = [&]() {
+        phaseDepth = depth;
+
+        for (size_t i = next++; i < inputs.size(); i = next++)
+        {
+            if (!compileFile(inputs[i], fold, bitcode, cache))
+            {
+                failed++;
+
+                lock_guard<mutex> lock(errorLock);
+                cerr << "division-interpreter: can not read " << inputs[i] << "\n";
+            }
+        }
+    };
+
+    vector<thread> threads;
+    for (int i = 1; i < jobs; i++)
+        threads.push_back(thread(worker));
+
+    worker();
+
+    for (auto &pending : threads)
+        pending.join();
+
+    phase.end();
+    double milliseconds = elapsedMs(start);
+
+    cerr << "compiled " << inputs.size() - failed << " files in " << fixed << setprecision(1) << milliseconds << " ms with "
+         << jobs << " threads (" << setprecision(0) << (inputs.size() - failed) * 1000.0 / max(milliseconds, 0.001) << " files/sec)\n";
+
+    return failed > 0 ? 1 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+
+    vector<ASTNode *> program; //vector to hold Nodes for code generation
+
+    string inputFile;
+    bool run = false;      //--run executes the program in process with the JIT instead of writing the .ll file
+    bool evaluate = false; //--eval executes the program by walking the AST, LLVM is not used
+    bool vm = false;       //--vm compiles the program to bytecode and runs it
+    bool disassemble = false; //--disasm prints the bytecode instead of running it
+    bool arenaStats = false;  //--arena-stats prints how much memory the AST uses
+    bool fold = true;         //--no-fold keeps constant expressions as they are written
+    bool bitcode = false;     //--emit-bc writes bitcode to the .bc file instead of IR code to the .ll file
+    bool native = false;      //--native compiles the program to an executable, -O0 to -O3 set the optimization level
+    int level = 2;
+    bool batch = false;       //--batch compiles every input (files or directories of .my files) to .bc or .ll files
+    int jobs = thread::hardware_concurrency(); //--jobs=N sets the number of threads of --batch
+    string cacheDirectory;    //--cache=DIR keeps compiled programs in DIR and reuses them while the source is unchanged
+    string columnsFile;       //--columns=FILE runs the program for every row of a CSV table of inputs, over whole columns at once
+    bool stream = false;      //--stream writes the IR code of every statement as soon as it is parsed, see streamProgram()
+    string serveSocket;       //--serve=SOCKET runs programs sent to the Unix domain socket SOCKET until it is killed
+    int timeLimit = 10000;    //--time-limit=MS stops the programs the server runs after MS milliseconds
+    string clientSocket;      //--client=SOCKET sends the input to the server at SOCKET, --stats asks for its statistics
+    bool stats = false;
+    bool timeReport = false;  //--time-report prints the time and allocations of every phase to stderr
+    string traceFile;         //--trace=FILE writes the phases as a Chrome trace event file
+    vector<string> inputs;
+
+    //Reads options and the input file name
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+
+        if (arg == "--run")
+            run = true;
+        else if (arg == "--eval")
+            evaluate = true;
+        else if (arg == "--vm")
+            vm = true;
+        else if (arg == "--disasm")
+            disassemble = true;
+        else if (arg == "--arena-stats")
+            arenaStats = true;
+        else if (arg == "--no-fold")
+            fold = false;
+        else if (arg == "--native")
+            native = true;
+        else if (arg.size() == 3 && arg.compare(0, 2, "-O") == 0 && arg[2] >= '0' && arg[2] <= '3')
+            level = arg[2] - '0';
+        else if (arg == "--emit-bc")
+            bitcode = true;
+        else if (arg == "--emit-ll")
+            bitcode = false;
+        else if (arg == "--batch")
+            batch = true;
+        else if (arg.compare(0, 7, "--jobs=") == 0)
+            jobs = atoi(arg.c_str() + 7);
+        else if (arg.compare(0, 8, "--cache=") == 0)
+            cacheDirectory = arg.substr(8);
+        else if (arg.compare(0, 10, "--columns=") == 0)
+            columnsFile = arg.substr(10);
+        else if (arg.compare(0, 8, "--serve=") == 0)
+            serveSocket = arg.substr(8);
+        else if (arg.compare(0, 13, "--time-limit=") == 0)
+            timeLimit = atoi(arg.c_str() + 13);
+        else if (arg.compare(0, 9, "--client=") == 0)
+            clientSocket = arg.substr(9);
+        else if (arg == "--stats")
+            stats = true;
+        else if (arg == "--stream")
+            stream = true;
+        else if (arg == "--time-report")
+            timeReport = true;
+        else if (arg.compare(0, 8, "--trace=") == 0)
+            traceFile = arg.substr(8);
+        else
+        {
+            inputFile = arg;
+            addInputs(arg, inputs);
+        }
+    }
+
+    if (serveSocket != "")
+        return runServer(serveSocket, max(jobs, 1), max(timeLimit, 1));
+
+    //The server runs the program with the JIT for --run, the bytecode VM for --vm and the evaluator otherwise
+    if (clientSocket != "" && (stats || inputFile != ""))
+        return runClient(clientSocket, run ? "jit" : vm ? "vm" : "eval", inputFile, stats);
+
+    if (inputFile == "")
+    {
+        cerr << "usage: " << argv[0] << " [--run | --eval | --vm | --disasm | --native [-O0..-O3]] [--emit-bc | --emit-ll] [--arena-stats] [--no-fold] [--cache=DIR]\n"
+             << "       " << string(strlen(argv[0]), ' ') << " [--time-report] [--trace=FILE.json] <input.my>\n"
+             << "       " << argv[0] << " --stream [--arena-stats] [--no-fold] <input.my>\n"
+             << "       " << argv[0] << " --columns=FILE.csv [--eval] [--no-fold] <input.my>\n"
+             << "       " << argv[0] << " --serve=SOCKET [--jobs=N] [--time-limit=MS]\n"
+             << "       " << argv[0] << " --client=SOCKET [--run | --vm | --eval] <input.my>\n"
+             << "       " << argv[0] << " --client=SOCKET --stats\n"
+             << "       " << argv[0] << " --batch [--jobs=N] [--emit-bc | --emit-ll] [--no-fold] [--cache=DIR] <input.my | directory>...\n";
+        return 1;
+    }
+
+    //Reports the phases when main returns, after every phase has ended. --run always prints its timings
+    Profiler runProfiler(timeReport || run, traceFile);
+
+    if (timeReport || run || traceFile != "")
+        profiler = &runProfiler;
+
+    //The evaluator and columnar runs walk the AST and --arena-stats needs the AST, nothing is cached
+    //for them and executables and streamed programs are not cached
+    Cache *cache = cacheDirectory != "" && !evaluate && !arenaStats && !native && !stream && columnsFile == "" ? new Cache(cacheDirectory) : NULL;
+
+    if (batch)
+        return compileBatch(inputs, max(jobs, 1), fold, bitcode, cache);
+
+    string outputFile = outputName(inputFile, bitcode);
+
+    ScopedPhase readPhase("read input");
+    InputBuffer input(inputFile);
+
+    readPhase.end();
+
+    if (input.error)
+    {
+        cerr << "division-interpreter: can not read " << inputFile << "\n";
+        return 1;
+    }
+
+    //Streaming writes IR code, bitcode can only be written once the whole module is in memory
+    if (stream)
+    {
+        streamProgram(input, outputName(inputFile, false), fold, arenaStats);
+        return 0;
+    }
+
+    //A program compiled before is taken from the cache, it is not tokenized and parsed again
+    const char *cacheKind = vm || disassemble ? "bytecode" : run || !bitcode ? "ll" : "bc";
+    string cacheKey;
+
+    if (cache != NULL)
+    {
+        string contents;
+        ScopedPhase phase("cache load");
+        cacheKey = cache->key(input.data, input.size, string(cacheKind) + (fold ? "" : " --no-fold"));
+        bool loaded = cache->load(cacheKey, cacheKind, contents);
+
+        phase.end();
+
+        if (loaded)
+        {
+            if (vm || disassemble)
+            {
+                Bytecode *bytecode = loadBytecode(contents);
+                ScopedPhase phase(disassemble ? "disassemble" : "run bytecode");
+
+                if (disassemble && bytecode != NULL)
+                    disassembleBytecode(bytecode, cout);
+                else if (bytecode != NULL)
+                    runBytecode(bytecode);
+
+                //A damaged entry is compiled again
+                if (bytecode != NULL)
+                    return 0;
+            }
+            else if (run)
+                return runProgram(contents);
+            else
+            {
+                ofstream(outputFile, ios::binary).write(contents.data(), contents.size());
+                return 0;
+            }
+        }
+    }
+
+    Arena arena; //all nodes and names of the program, freed when main returns
+    Tokenizer *tokenizer = new Tokenizer(input.data, input.size, &arena);
+    Parser *parser = new Parser(tokenizer, &arena);
+
+    //Parse till there is an error or it is end of file
+    parseProgram(parser, program);
+
+    //Folds the constant expressions before any code is generated
+    if (fold && !parser->error)
+    {
+        ScopedPhase phase("fold", "", &arena);
+        foldConstants(program, arena);
+        numberValues(program, parser->variables, arena);
+        removeDeadStores(program, parser->variables);
+    }
+
+    if (arenaStats)
+        printArenaStats(arena);
+
+    //Runs the program for every row of the table, --eval runs the rows one by one instead of over columns
+    if (columnsFile != "")
+    {
+        if (parser->error)
+        {
+            printf("Line %d: syntax error\n", parser->errLine);
+            return 0;
+        }
+
+        ScopedPhase phase("run columns");
+        return runColumns(program, parser->variables, columnsFile, evaluate);
+    }
+
+    //Executes the AST directly, prints the same output as the IR code would
+    if (evaluate)
+    {
+        if (parser->error)
+        {
+            printf("Line %d: syntax error\n", parser->errLine);
+            return 0;
+        }
+
+        vector<int> variables(parser->variables.size());
+        ScopedPhase phase("evaluate");
+
+        for (auto expression : program)
+        {
+            expression->evaluate(variables);
+        }
+
         return 0;
     }
 
-    //generate code
-    generateIR(outFile, program, parser->variables);
+    //Compiles the program to bytecode and runs or prints it
+    if (vm || disassemble)
+    {
+        if (parser->error)
+        {
+            printf("Line %d: syntax error\n", parser->errLine);
+            return 0;
+        }
+
+        ScopedPhase compilePhase("compile bytecode");
+        Bytecode *bytecode = compileBytecode(program, parser->variables);
+
+        compilePhase.end();
+
+        if (cache != NULL)
+        {
+            ScopedPhase phase("cache store");
+            string contents;
+            saveBytecode(bytecode, contents);
+            cache->store(cacheKey, cacheKind, contents);
+        }
+
+        ScopedPhase phase(disassemble ? "disassemble" : "run bytecode");
+
+        if (disassemble)
+            disassembleBytecode(bytecode, cout);
+        else
+            runBytecode(bytecode);
+
+        return 0;
+    }
+
+    //Builds the module in memory and executes it, nothing but the cache entry is written to disk
+    if (run)
+    {
+        ScopedPhase irPhase("generateIR");
+        ostringstream ir;
+
+        if (parser->error)
+            syntaxError(parser->errLine, ir);
+        else
+            generateIR(ir, program, parser->variables);
+
+        irPhase.end();
+
+        if (cache != NULL)
+        {
+            ScopedPhase phase("cache store");
+            cache->store(cacheKey, cacheKind, ir.str());
+        }
+
+        return runProgram(ir.str());
+    }
+
+    //Builds a standalone executable named like the input without .my
+    if (native)
+    {
+        ScopedPhase irPhase("generateIR");
+        ostringstream ir;
+
+        if (parser->error)
+            syntaxError(parser->errLine, ir);
+        else
+            generateIR(ir, program, parser->variables);
+
+        irPhase.end();
+
+        return buildExecutable(ir.str(), level, inputFile.substr(0, inputFile.size() - 3)) ? 0 : 1;
+    }
 
-    outFile.close();
+    writeProgram(outputFile, parser, program, bitcode, cache, cacheKey);
 
     return 0;
 }
\ No newline at end of file
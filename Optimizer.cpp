@@ -0,0 +1,1279 @@
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <fstream>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <climits>
+#include <cstring>
+
+using namespace std;
+
+class BytecodeCompiler;
+class Columns;
+
+/**
+ * Memory for everything created during one compilation: AST nodes and their strings.
+ * Memory is handed out from large blocks and released all at once by reset() or the destructor,
+ * objects that need a destructor call (like the statement vector of ConditionalNode) are
+ * remembered and destroyed at that point.
+ * */
+class Arena
+{
+public:
+    struct Cleanup
+    {
+        void (*destroy)(void *object);
+        void *object;
+        Cleanup *next;
+    };
+
+    vector<pair<char *, size_t>> blocks;
+    char *position; //free part of the current block
+    char *limit;
+    size_t blockSize;
+    Cleanup *cleanups;
+
+    size_t allocations;
+    size_t bytesAllocated; //bytes handed out since the last reset
+    size_t peakBytes;      //largest value of bytesAllocated
+    size_t bytesReserved;  //size of all blocks
+
+    Arena(size_t _blockSize = 1 << 16);
+    ~Arena();
+
+    void *allocate(size_t size, size_t alignment = alignof(void *));
+    const char *copyString(const string &text);
+    void reset();
+
+    /**
+     * Creates an object in the arena
+     * */
+    template <typename T, typename... Args>
+    T *make(Args &&... args)
+    {
+        T *object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+
+        if (!is_trivially_destructible<T>::value)
+        {
+            Cleanup *cleanup = (Cleanup *)allocate(sizeof(Cleanup), alignof(Cleanup));
+            cleanup->destroy = [](void *object) { ((T *)object)->~T(); };
+            cleanup->object = object;
+            cleanup->next = cleanups;
+            cleanups = cleanup;
+        }
+
+        return object;
+    }
+};
+
+/**
+ * Result of the code generation of an expression: an integer constant or the number of a temporary
+ * */
+struct Value
+{
+    bool temporary;
+    int number;
+};
+
+/**
+ * Name of a basic block, written as <kind>_<index><part> like cond_3body.
+ * Labels with a negative index are written as <kind> only
+ * */
+struct Label
+{
+    const char *kind;
+    int index;
+    const char *part;
+};
+
+class IREmitter;
+
+/**
+ * Abstract class for Asynchronous Syntax Tree
+ * */
+class ASTNode
+{
+public:
+    virtual Value generateCode(IREmitter &output) = 0;
+    virtual int evaluate(vector<int> &variables) = 0;
+    virtual int compile(BytecodeCompiler &compiler, int target) = 0;
+    virtual ASTNode *fold(Arena &arena) = 0;
+    virtual const int *evaluateColumns(Columns &columns, const int *mask) = 0;
+ };
+
+/**
+ * Stores identifier of variables. Can generate code with temp variables
+ * */
+class IdentifierNode : public ASTNode
+{
+public:
+    const char *name;
+    int slot; //index of the variable in Parser::variables and in the variables of every backend
+    IdentifierNode(const char *_name, int _slot);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+    string getID();
+};
+
+
+/**
+ * Stores values for numbers. generateCode() function returns the integer value
+ * */
+class NumberNode : public ASTNode
+{
+public:
+    int value;
+    NumberNode(int _value);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node for choose expression, stores the expressions inside parantheses. 
+ * Generates code for both expressions and choose function.
+ * */
+class ChooseNode : public ASTNode
+{
+public:
+    ASTNode *expr1, *expr2, *expr3, *expr4;
+    ChooseNode(ASTNode *_expr1, ASTNode *_expr2, ASTNode *_expr3, ASTNode *_expr4);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node for binary operations. Stores the operation type, right and left handside as expressions
+ * and generates code for the calculation
+ * */
+class BinaryOperationNode : public ASTNode
+{
+public:
+    ASTNode *left;
+    ASTNode *right;
+    char operation;
+
+    BinaryOperationNode(ASTNode *_left, ASTNode *_right, char _operation);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node for division by a constant divisor, fold() creates it from BinaryOperationNode.
+ * The division is calculated with a multiplication and shifts instead of a division instruction
+ * */
+class ConstantDivisionNode : public ASTNode
+{
+public:
+    ASTNode *dividend;
+    int divisor;    //anything but 0, 1 and -1
+    int multiplier; //0 if the absolute value of divisor is a power of two
+    int shift;
+
+    ConstantDivisionNode(ASTNode *_dividend, int _divisor);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node for a division that always traps, by zero or INT_MIN / -1. fold() creates it from
+ * BinaryOperationNode, the operands are dropped since the division traps whatever they calculate
+ * */
+class TrapNode : public ASTNode
+{
+public:
+    TrapNode();
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node for print statements. Generates code for print statement and expression inside the statement
+ * */
+class PrintNode : public ASTNode
+{
+public:
+    ASTNode *expr;
+    PrintNode(ASTNode *_expr);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node to store conditional statements. Stores the condition, conditional type and statements
+ * inside the code block and generates code for all of them
+ * */
+class ConditionalNode : public ASTNode
+{
+public:
+    int type;
+    ASTNode *condition;
+    vector<ASTNode *> statements;
+
+    ConditionalNode(int _type, ASTNode *_condition);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node for assignment statement. Stores identifier and expression 
+ * Generates code for assignment statement
+ * */
+class AssignNode : public ASTNode
+{
+public:
+    IdentifierNode *identifier;
+    ASTNode *expr;
+    AssignNode(IdentifierNode *id, ASTNode *expr);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Returns the node as a NumberNode if it is a literal, otherwise NULL
+ * */
+static NumberNode *literal(ASTNode *node)
+{
+    return dynamic_cast<NumberNode *>(node);
+}
+
+/**
+ * Folds every statement of the list. Statements that can never run are removed from it
+ * */
+static void foldStatements(vector<ASTNode *> &statements, Arena &arena)
+{
+    size_t count = 0;
+
+    for (auto statement : statements)
+    {
+        ASTNode *folded = statement->fold(arena);
+
+        if (folded != NULL)
+            statements[count++] = folded;
+    }
+
+    statements.resize(count);
+}
+
+/****************
+ * Constant folding
+ *
+ * fold() returns the node that replaces the node, expressions with literal operands become a NumberNode.
+ * The results are the same as the add, sub, mul and sdiv instructions would calculate. Divisions that
+ * always trap (by zero and INT_MIN / -1) become a TrapNode, x / -1 only traps for INT_MIN and stays a
+ * runtime operation.
+ * **************/
+
+ASTNode *IdentifierNode::fold(Arena &arena)
+{
+    return this;
+}
+
+ASTNode *NumberNode::fold(Arena &arena)
+{
+    return this;
+}
+
+/**
+ * Operations and chooses nested deeper than this fold their operands with foldExpression() instead of recursive calls
+ * */
+static const int recursionLimit = 1000;
+
+static thread_local int expressionDepth = 0;
+
+static ASTNode *foldExpression(ASTNode *expression, Arena &arena);
+
+/**
+ * A choose with a literal first expression is replaced by the expression it chooses,
+ * the other expressions would never be calculated
+ * */
+ASTNode *ChooseNode::fold(Arena &arena)
+{
+    if (expressionDepth >= recursionLimit)
+        return foldExpression(this, arena);
+
+    expressionDepth++;
+    expr1 = expr1->fold(arena);
+
+    NumberNode *selector = literal(expr1);
+    ASTNode *folded = this;
+
+    if (selector != NULL)
+        folded = (selector->value == 0 ? expr2 : selector->value > 0 ? expr3 : expr4)->fold(arena);
+    else
+    {
+        expr2 = expr2->fold(arena);
+        expr3 = expr3->fold(arena);
+        expr4 = expr4->fold(arena);
+    }
+    expressionDepth--;
+
+    return folded;
+}
+
+/**
+ * Replaces the operands of the operation with their folded nodes and folds the operation
+ * */
+static ASTNode *foldOperation(BinaryOperationNode *node, ASTNode *left, ASTNode *right, Arena &arena)
+{
+    node->left = left;
+    node->right = right;
+
+    NumberNode *operand1 = literal(left);
+    NumberNode *operand2 = literal(right);
+
+    if (operand2 != NULL && operand1 == NULL && node->operation == '/')
+    {
+        //x / 1 is x, x / 0 always traps and x / -1 traps for INT_MIN so it keeps the division instruction
+        if (operand2->value == 1)
+            return left;
+        if (operand2->value == 0)
+            return arena.make<TrapNode>();
+        if (operand2->value == -1)
+            return node;
+
+        return arena.make<ConstantDivisionNode>(left, operand2->value);
+    }
+
+    if (operand1 == NULL || operand2 == NULL)
+        return node;
+
+    unsigned value1 = operand1->value, value2 = operand2->value;
+
+    switch (node->operation)
+    {
+    case ('+'):
+        return arena.make<NumberNode>((int)(value1 + value2));
+    case ('-'):
+        return arena.make<NumberNode>((int)(value1 - value2));
+    case ('*'):
+        return arena.make<NumberNode>((int)(value1 * value2));
+    default:
+        //Division by zero and INT_MIN / -1 trap at runtime
+        if (operand2->value == 0 || (operand1->value == INT_MIN && operand2->value == -1))
+            return arena.make<TrapNode>();
+
+        return arena.make<NumberNode>(operand1->value / operand2->value);
+    }
+}
+
+ASTNode *BinaryOperationNode::fold(Arena &arena)
+{
+    if (expressionDepth >= recursionLimit)
+        return foldExpression(this, arena);
+
+    expressionDepth++;
+    ASTNode *foldedLeft = left->fold(arena);
+    ASTNode *foldedRight = right->fold(arena);
+    expressionDepth--;
+
+    return foldOperation(this, foldedLeft, foldedRight, arena);
+}
+
+/**
+ * Folds the operations and chooses of an expression with an explicit stack instead of recursion, so
+ * expressions nested as deep as the parser allows do not overflow the stack. Other nodes fold their
+ * own operands. Shallow operations recurse, which is faster, till recursionLimit
+ * */
+static ASTNode *foldExpression(ASTNode *expression, Arena &arena)
+{
+    //A node still to be folded with the number of its operands folded so far
+    struct Step
+    {
+        ASTNode *node;
+        int stage;
+    };
+
+    //The stacks are kept between calls, leaves folded on the way may fold expressions of their own above them
+    static thread_local vector<Step> steps;
+    static thread_local vector<ASTNode *> folded;
+
+    size_t base = steps.size();
+    steps.push_back(Step{expression, 0});
+
+    while (steps.size() > base)
+    {
+        Step step = steps.back();
+        steps.pop_back();
+
+        if (BinaryOperationNode *operation = dynamic_cast<BinaryOperationNode *>(step.node))
+        {
+            if (step.stage == 0)
+            {
+                steps.push_back(Step{operation, 1});
+                steps.push_back(Step{operation->right, 0});
+                steps.push_back(Step{operation->left, 0});
+                continue;
+            }
+
+            ASTNode *right = folded.back();
+            folded.pop_back();
+            folded.back() = foldOperation(operation, folded.back(), right, arena);
+        }
+        else if (ChooseNode *choose = dynamic_cast<ChooseNode *>(step.node))
+        {
+            if (step.stage == 0)
+            {
+                steps.push_back(Step{choose, 1});
+                steps.push_back(Step{choose->expr1, 0});
+                continue;
+            }
+
+            if (step.stage == 1)
+            {
+                choose->expr1 = folded.back();
+                folded.pop_back();
+
+                //A constant first expression leaves only the expression it chooses
+                NumberNode *selector = literal(choose->expr1);
+
+                if (selector != NULL)
+                    steps.push_back(Step{selector->value == 0 ? choose->expr2 : selector->value > 0 ? choose->expr3 : choose->expr4, 0});
+                else
+                {
+                    steps.push_back(Step{choose, 2});
+                    steps.push_back(Step{choose->expr4, 0});
+                    steps.push_back(Step{choose->expr3, 0});
+                    steps.push_back(Step{choose->expr2, 0});
+                }
+                continue;
+            }
+
+            choose->expr4 = folded.back();
+            folded.pop_back();
+            choose->expr3 = folded.back();
+            folded.pop_back();
+            choose->expr2 = folded.back();
+            folded.back() = choose;
+        }
+        else
+            folded.push_back(step.node->fold(arena));
+    }
+
+    ASTNode *result = folded.back();
+    folded.pop_back();
+    return result;
+}
+
+ASTNode *ConstantDivisionNode::fold(Arena &arena)
+{
+    dividend = dividend->fold(arena);
+
+    NumberNode *operand = literal(dividend);
+
+    //The divisor is never 0 or -1 so the division can not trap
+    if (operand != NULL)
+        return arena.make<NumberNode>(operand->value / divisor);
+
+    return this;
+}
+
+ASTNode *TrapNode::fold(Arena &arena)
+{
+    return this;
+}
+
+ASTNode *PrintNode::fold(Arena &arena)
+{
+    expr = expr->fold(arena);
+    return this;
+}
+
+/**
+ * Conditionals whose condition is the literal 0 never run their block and are removed
+ * */
+ASTNode *ConditionalNode::fold(Arena &arena)
+{
+    condition = condition->fold(arena);
+
+    NumberNode *value = literal(condition);
+
+    if (value != NULL && value->value == 0)
+        return NULL;
+
+    foldStatements(statements, arena);
+
+    return this;
+}
+
+ASTNode *AssignNode::fold(Arena &arena)
+{
+    expr = expr->fold(arena);
+    return this;
+}
+
+/**
+ * Folds the constant expressions of the program before code generation
+ * */
+void foldConstants(vector<ASTNode *> &program, Arena &arena)
+{
+    foldStatements(program, arena);
+}
+
+/****************
+ * Value numbering
+ *
+ * Every expression gets a value number, expressions with the same number calculate the same value.
+ * A variable has the number of the value assigned to it last, so a / b after b = c has the number of
+ * a / c. Calculations that are reused are moved into an assignment to a new temporary variable in
+ * front of their statement (an operation of three addresses) and the reuses read the temporary,
+ * which every backend handles like any other variable.
+ * **************/
+
+/**
+ * Kind and operand numbers of an operation, constant division, choose or literal, which give it its value number
+ * */
+struct ValueKey
+{
+    int kind;        //the operator of an operation, 'd' for a constant division, 'c' for a choose, 'n' for a literal, 0 for none
+    int operands[4]; //value numbers of the operands, the divisor of a constant division, the value of a literal
+
+    bool operator==(const ValueKey &other) const
+    {
+        return kind == other.kind && memcmp(operands, other.operands, sizeof(operands)) == 0;
+    }
+};
+
+/**
+ * Finds the values a program calculates more than once. The first pass counts how often the first
+ * calculation of every value is reused, the second pass moves the reused calculations into temporaries.
+ * Only calculations their statement always runs are moved, not those in the last three expressions
+ * of a choose or in the condition of a while, so no division runs (and traps) that did not run before.
+ * Variables assigned in an if have new numbers after it, variables assigned in a while have new
+ * numbers from the loop header on. Calculations in a block are only reused in the block
+ * */
+class ValueNumbering
+{
+public:
+    vector<string> &variables;
+    Arena &arena;
+    bool rewrite; //false in the first pass
+
+    //Value number of a key in table, value -1 for an empty entry
+    struct TableEntry
+    {
+        unsigned hash;
+        int value;
+    };
+
+    vector<ValueKey> keys;       //key of every value number, numbers are indexes
+    vector<TableEntry> table;    //open addressing
+    size_t entries;              //keys in table
+    vector<int> variableNumbers; //value number of every variable slot
+    vector<int> available;       //first calculation of every value number that can be reused here, or -1
+    vector<int> availableLog;    //value numbers made available in the order they were added
+    vector<int> reuses;          //number of reuses of every first calculation, counted by the first pass
+    vector<int> temporaries;     //slot of the temporary of every first calculation, -1 if it is not reused
+    int calculations;            //first calculations seen so far
+
+    ValueNumbering(vector<string> &_variables, Arena &_arena);
+    void start(bool _rewrite);
+    void statements(vector<ASTNode *> &list);
+    int expression(ASTNode *&root, bool record, vector<ASTNode *> &hoisted);
+
+private:
+    //A node still to be numbered, it is numbered after its operands
+    struct NumberingStep
+    {
+        ASTNode *node;
+        bool operandsDone;
+    };
+
+    //A node to look at with the place that points to it, or the end of a first calculation after its operands
+    struct Visit
+    {
+        ASTNode **place;
+        int position;    //position of the node in nodeNumbers
+        bool conditional;
+        int calculation; //first calculation that ends here, -1 for a node to look at
+    };
+
+    vector<NumberingStep> steps;
+    vector<Visit> visits;
+
+    //Numbers of the nodes of every expression of the program, operands before their node. The first
+    //pass numbers the expressions, the second pass reads the same numbers again
+    vector<int> nodeNumbers;
+    vector<int> nodeSizes;      //number of nodes in the expression of every node
+    vector<int> expressionEnds; //end of the nodes of every expression in nodeNumbers
+    int expressions;            //expressions seen so far by the second pass
+
+    int number(const ValueKey &key);
+    int newNumber();
+    void numberNodes(ASTNode *root);
+    IdentifierNode *identifier(int slot);
+};
+
+ValueNumbering::ValueNumbering(vector<string> &_variables, Arena &_arena) : variables(_variables), arena(_arena)
+{
+    this->rewrite = false;
+    this->calculations = 0;
+    this->expressions = 0;
+    this->entries = 0;
+}
+
+/**
+ * Starts a pass over the program, the second pass keeps the numbers and reuses of the first
+ * */
+void ValueNumbering::start(bool _rewrite)
+{
+    rewrite = _rewrite;
+    availableLog.clear();
+    temporaries.clear();
+    calculations = 0;
+    expressions = 0;
+
+    if (!rewrite)
+    {
+        table.assign(1024, TableEntry{0, -1});
+        entries = 0;
+
+        //Every variable starts as 0
+        variableNumbers.assign(variables.size(), number(ValueKey{'n', {0, 0, 0, 0}}));
+    }
+
+    available.assign(keys.size(), -1);
+}
+
+/**
+ * Returns the value number of the key, a new number for a key not seen before
+ * */
+int ValueNumbering::number(const ValueKey &key)
+{
+    //Multiplicative hash of the kind and operands, the high bits are mixed best
+    unsigned long long mixed = key.kind;
+    for (int operand : key.operands)
+        mixed = (mixed ^ (unsigned)operand) * 0x9E3779B97F4A7C15ull;
+    unsigned hash = mixed >> 32;
+
+    size_t mask = table.size() - 1;
+    size_t slot = hash & mask;
+
+    //Linear probing until the key or an empty slot is found
+    while (table[slot].value != -1)
+    {
+        if (table[slot].hash == hash && keys[table[slot].value] == key)
+            return table[slot].value;
+
+        slot = (slot + 1) & mask;
+    }
+
+    int value = newNumber();
+    keys.back() = key;
+    table[slot] = TableEntry{hash, value};
+    entries++;
+
+    //Keeps the table at most half full
+    if (entries * 2 > table.size())
+    {
+        vector<TableEntry> old(table.size() * 2, TableEntry{0, -1});
+        table.swap(old);
+        mask = table.size() - 1;
+
+        for (TableEntry entry : old)
+        {
+            if (entry.value == -1)
+                continue;
+
+            slot = entry.hash & mask;
+            while (table[slot].value != -1)
+                slot = (slot + 1) & mask;
+            table[slot] = entry;
+        }
+    }
+
+    return value;
+}
+
+/**
+ * Returns a value number different from every other, for a value that is not known to equal any other
+ * */
+int ValueNumbering::newNumber()
+{
+    keys.push_back(ValueKey{0, {0, 0, 0, 0}});
+    available.push_back(-1);
+    return keys.size() - 1;
+}
+
+IdentifierNode *ValueNumbering::identifier(int slot)
+{
+    return arena.make<IdentifierNode>(arena.copyString(variables[slot]), slot);
+}
+
+/**
+ * Adds the numbers of the nodes of the expression to nodeNumbers in post-order. The last operand of a
+ * node is right in front of it, the operand before it in front of the nodes of the last operand and so on
+ * */
+void ValueNumbering::numberNodes(ASTNode *root)
+{
+    steps.push_back(NumberingStep{root, false});
+
+    while (!steps.empty())
+    {
+        NumberingStep step = steps.back();
+        steps.pop_back();
+
+        ASTNode *node = step.node;
+        BinaryOperationNode *operation = dynamic_cast<BinaryOperationNode *>(node);
+        ConstantDivisionNode *division = operation == NULL ? dynamic_cast<ConstantDivisionNode *>(node) : NULL;
+        ChooseNode *choose = operation == NULL && division == NULL ? dynamic_cast<ChooseNode *>(node) : NULL;
+
+        if (!step.operandsDone && (operation != NULL || division != NULL || choose != NULL))
+        {
+            steps.push_back(NumberingStep{node, true});
+
+            if (operation != NULL)
+            {
+                steps.push_back(NumberingStep{operation->right, false});
+                steps.push_back(NumberingStep{operation->left, false});
+            }
+            else if (division != NULL)
+                steps.push_back(NumberingStep{division->dividend, false});
+            else
+            {
+                steps.push_back(NumberingStep{choose->expr4, false});
+                steps.push_back(NumberingStep{choose->expr3, false});
+                steps.push_back(NumberingStep{choose->expr2, false});
+                steps.push_back(NumberingStep{choose->expr1, false});
+            }
+            continue;
+        }
+
+        int value;
+        int size = 1;
+        int operand = nodeNumbers.size() - 1;
+
+        if (operation != NULL)
+        {
+            int right = nodeNumbers[operand];
+            size += nodeSizes[operand];
+            operand -= nodeSizes[operand];
+
+            int left = nodeNumbers[operand];
+            size += nodeSizes[operand];
+
+            //a + b and a * b are the same values as b + a and b * a
+            if ((operation->operation == '+' || operation->operation == '*') && left > right)
+                swap(left, right);
+
+            value = number(ValueKey{operation->operation, {left, right, 0, 0}});
+        }
+        else if (division != NULL)
+        {
+            size += nodeSizes[operand];
+            value = number(ValueKey{'d', {nodeNumbers[operand], division->divisor, 0, 0}});
+        }
+        else if (choose != NULL)
+        {
+            int expressions[4];
+
+            for (int i = 3; i >= 0; i--)
+            {
+                expressions[i] = nodeNumbers[operand];
+                size += nodeSizes[operand];
+                operand -= nodeSizes[operand];
+            }
+
+            value = number(ValueKey{'c', {expressions[0], expressions[1], expressions[2], expressions[3]}});
+        }
+        else if (IdentifierNode *variable = dynamic_cast<IdentifierNode *>(node))
+            value = variableNumbers[variable->slot];
+        else if (NumberNode *constant = literal(node))
+            value = number(ValueKey{'n', {constant->value, 0, 0, 0}});
+        else
+            value = newNumber();
+
+        nodeNumbers.push_back(value);
+        nodeSizes.push_back(size);
+    }
+}
+
+/**
+ * Reuses the values of the expression that were calculated before and, when record is set, makes its
+ * calculations available to the code after it. In the second pass the expression is rewritten and the
+ * assignments of its temporaries are added to hoisted. Returns the value number of the expression
+ * */
+int ValueNumbering::expression(ASTNode *&root, bool record, vector<ASTNode *> &hoisted)
+{
+    if (!rewrite)
+    {
+        numberNodes(root);
+        expressionEnds.push_back(nodeNumbers.size());
+    }
+
+    int rootPosition = expressionEnds[expressions++] - 1;
+    int rootNumber = nodeNumbers[rootPosition];
+
+    //Nodes are looked at before their operands, so the largest calculation that can be reused is
+    visits.push_back(Visit{&root, rootPosition, false, -1});
+
+    while (!visits.empty())
+    {
+        Visit visit = visits.back();
+        visits.pop_back();
+
+        ASTNode *node = *visit.place;
+        int value = nodeNumbers[visit.position];
+
+        //The operands of a reused calculation are done, it moves into a temporary
+        if (visit.calculation >= 0)
+        {
+            if (rewrite && reuses[visit.calculation] > 0)
+            {
+                int slot = variables.size();
+                variables.push_back("tmp." + to_string(slot));
+                variableNumbers.push_back(value);
+                temporaries[visit.calculation] = slot;
+
+                hoisted.push_back(arena.make<AssignNode>(identifier(slot), node));
+                *visit.place = identifier(slot);
+            }
+            continue;
+        }
+
+        BinaryOperationNode *operation = dynamic_cast<BinaryOperationNode *>(node);
+        ConstantDivisionNode *division = operation == NULL ? dynamic_cast<ConstantDivisionNode *>(node) : NULL;
+        ChooseNode *choose = operation == NULL && division == NULL ? dynamic_cast<ChooseNode *>(node) : NULL;
+
+        //Literals and variables cost nothing to calculate again
+        if (operation == NULL && division == NULL && choose == NULL)
+            continue;
+
+        int first = available[value];
+
+        if (first >= 0)
+        {
+            if (rewrite)
+                *visit.place = identifier(temporaries[first]);
+            else
+                reuses[first]++;
+            continue;
+        }
+
+        if (record && !visit.conditional)
+        {
+            int calculation = calculations++;
+            available[value] = calculation;
+            availableLog.push_back(value);
+
+            if (rewrite)
+                temporaries.push_back(-1);
+            else
+                reuses.push_back(0);
+
+            visits.push_back(Visit{visit.place, visit.position, false, calculation});
+        }
+
+        int operand = visit.position - 1;
+
+        if (operation != NULL)
+        {
+            visits.push_back(Visit{&operation->right, operand, visit.conditional, -1});
+            visits.push_back(Visit{&operation->left, operand - nodeSizes[operand], visit.conditional, -1});
+        }
+        else if (division != NULL)
+            visits.push_back(Visit{&division->dividend, operand, visit.conditional, -1});
+        else
+        {
+            //Only one of the last three expressions is calculated
+            ASTNode **expressions[4] = {&choose->expr1, &choose->expr2, &choose->expr3, &choose->expr4};
+
+            for (int i = 3; i >= 0; i--)
+            {
+                visits.push_back(Visit{expressions[i], operand, i > 0 || visit.conditional, -1});
+                operand -= nodeSizes[operand];
+            }
+        }
+    }
+
+    return rootNumber;
+}
+
+/**
+ * Adds the slots of the variables the statements assign to slots
+ * */
+static void assignedSlots(vector<ASTNode *> &statements, vector<int> &slots)
+{
+    for (auto statement : statements)
+    {
+        if (AssignNode *assign = dynamic_cast<AssignNode *>(statement))
+            slots.push_back(assign->identifier->slot);
+        else if (ConditionalNode *conditional = dynamic_cast<ConditionalNode *>(statement))
+            assignedSlots(conditional->statements, slots);
+    }
+}
+
+/**
+ * Numbers the statements of the list, in the second pass the assignments of the temporaries are
+ * put in front of the statement that first calculates their value
+ * */
+void ValueNumbering::statements(vector<ASTNode *> &list)
+{
+    vector<ASTNode *> rewritten;
+    vector<ASTNode *> hoisted;
+
+    for (auto statement : list)
+    {
+        hoisted.clear();
+
+        if (AssignNode *assign = dynamic_cast<AssignNode *>(statement))
+        {
+            //expression() adds the slots of temporaries, so the number is stored after it
+            int value = expression(assign->expr, true, hoisted);
+            variableNumbers[assign->identifier->slot] = value;
+        }
+        else if (PrintNode *print = dynamic_cast<PrintNode *>(statement))
+            expression(print->expr, true, hoisted);
+        else if (ConditionalNode *conditional = dynamic_cast<ConditionalNode *>(statement))
+        {
+            vector<int> assigned;
+            assignedSlots(conditional->statements, assigned);
+
+            if (conditional->type == 0)
+            {
+                //The condition always runs, its calculations stay available after the if
+                expression(conditional->condition, true, hoisted);
+                size_t mark = availableLog.size();
+
+                statements(conditional->statements);
+
+                while (availableLog.size() > mark)
+                {
+                    available[availableLog.back()] = -1;
+                    availableLog.pop_back();
+                }
+
+                for (int slot : assigned)
+                    variableNumbers[slot] = newNumber();
+            }
+            else
+            {
+                //Values at the loop header, which are the values after the loop too
+                vector<int> header;
+
+                for (int slot : assigned)
+                {
+                    variableNumbers[slot] = newNumber();
+                    header.push_back(variableNumbers[slot]);
+                }
+
+                size_t mark = availableLog.size();
+
+                expression(conditional->condition, false, hoisted);
+                statements(conditional->statements);
+
+                while (availableLog.size() > mark)
+                {
+                    available[availableLog.back()] = -1;
+                    availableLog.pop_back();
+                }
+
+                for (size_t i = 0; i < assigned.size(); i++)
+                    variableNumbers[assigned[i]] = header[i];
+            }
+        }
+        else
+            expression(statement, true, hoisted);
+
+        if (rewrite)
+        {
+            rewritten.insert(rewritten.end(), hoisted.begin(), hoisted.end());
+            rewritten.push_back(statement);
+        }
+    }
+
+    if (rewrite)
+        list.swap(rewritten);
+}
+
+/**
+ * Calculates every value the program calculates more than once only once, after foldConstants().
+ * The temporaries that hold the values are added to variables
+ * */
+void numberValues(vector<ASTNode *> &program, vector<string> &variables, Arena &arena)
+{
+    ValueNumbering numbering(variables, arena);
+
+    numbering.start(false);
+    numbering.statements(program);
+
+    bool reused = false;
+
+    for (int count : numbering.reuses)
+        reused = reused || count > 0;
+
+    if (!reused)
+        return;
+
+    numbering.start(true);
+    numbering.statements(program);
+}
+
+/****************
+ * Dead store elimination
+ *
+ * An assignment is dead when its variable is assigned again or the program ends before the value is
+ * read. Variables are live where their value may still be read, which is found backwards over the
+ * statements. Dead assignments and expression statements are removed, except for the divisions in
+ * them: a division by zero has to trap as before, so they stay as expression statements.
+ * **************/
+
+/**
+ * Sets the variables the expression reads live
+ * */
+static void addReads(ASTNode *expression, vector<char> &live)
+{
+    static thread_local vector<ASTNode *> pending;
+    pending.push_back(expression);
+
+    while (!pending.empty())
+    {
+        ASTNode *node = pending.back();
+        pending.pop_back();
+
+        if (IdentifierNode *variable = dynamic_cast<IdentifierNode *>(node))
+            live[variable->slot] = 1;
+        else if (BinaryOperationNode *operation = dynamic_cast<BinaryOperationNode *>(node))
+        {
+            pending.push_back(operation->right);
+            pending.push_back(operation->left);
+        }
+        else if (ConstantDivisionNode *division = dynamic_cast<ConstantDivisionNode *>(node))
+            pending.push_back(division->dividend);
+        else if (ChooseNode *choose = dynamic_cast<ChooseNode *>(node))
+        {
+            pending.push_back(choose->expr4);
+            pending.push_back(choose->expr3);
+            pending.push_back(choose->expr2);
+            pending.push_back(choose->expr1);
+        }
+    }
+}
+
+/**
+ * Sets the variables the statements read live
+ * */
+static void addBlockReads(vector<ASTNode *> &statements, vector<char> &live)
+{
+    for (auto statement : statements)
+    {
+        if (AssignNode *assign = dynamic_cast<AssignNode *>(statement))
+            addReads(assign->expr, live);
+        else if (PrintNode *print = dynamic_cast<PrintNode *>(statement))
+            addReads(print->expr, live);
+        else if (ConditionalNode *conditional = dynamic_cast<ConditionalNode *>(statement))
+        {
+            addReads(conditional->condition, live);
+            addBlockReads(conditional->statements, live);
+        }
+        else
+            addReads(statement, live);
+    }
+}
+
+/**
+ * Returns true if the expression has a division instruction, which traps on a zero divisor, or a trap
+ * */
+static bool canTrap(ASTNode *expression)
+{
+    static thread_local vector<ASTNode *> pending;
+    pending.assign(1, expression);
+
+    while (!pending.empty())
+    {
+        ASTNode *node = pending.back();
+        pending.pop_back();
+
+        if (BinaryOperationNode *operation = dynamic_cast<BinaryOperationNode *>(node))
+        {
+            if (operation->operation == '/')
+            {
+                pending.clear();
+                return true;
+            }
+
+            pending.push_back(operation->right);
+            pending.push_back(operation->left);
+        }
+        else if (ConstantDivisionNode *division = dynamic_cast<ConstantDivisionNode *>(node))
+            pending.push_back(division->dividend);
+        else if (ChooseNode *choose = dynamic_cast<ChooseNode *>(node))
+        {
+            pending.push_back(choose->expr4);
+            pending.push_back(choose->expr3);
+            pending.push_back(choose->expr2);
+            pending.push_back(choose->expr1);
+        }
+        else if (dynamic_cast<TrapNode *>(node) != NULL)
+        {
+            pending.clear();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Adds the parts of the expression that have to be calculated even when its value is not used to
+ * roots, in the order they are calculated: the outermost divisions and traps, and chooses that divide in the
+ * expressions they choose from, since which of them runs depends on the first expression
+ * */
+static void trapRoots(ASTNode *expression, vector<ASTNode *> &roots)
+{
+    static thread_local vector<ASTNode *> pending;
+    pending.push_back(expression);
+
+    while (!pending.empty())
+    {
+        ASTNode *node = pending.back();
+        pending.pop_back();
+
+        if (BinaryOperationNode *operation = dynamic_cast<BinaryOperationNode *>(node))
+        {
+            if (operation->operation == '/')
+                roots.push_back(operation);
+            else
+            {
+                pending.push_back(operation->right);
+                pending.push_back(operation->left);
+            }
+        }
+        else if (ConstantDivisionNode *division = dynamic_cast<ConstantDivisionNode *>(node))
+            pending.push_back(division->dividend);
+        else if (ChooseNode *choose = dynamic_cast<ChooseNode *>(node))
+        {
+            if (canTrap(choose->expr2) || canTrap(choose->expr3) || canTrap(choose->expr4))
+                roots.push_back(choose);
+            else
+                pending.push_back(choose->expr1);
+        }
+        else if (TrapNode *trap = dynamic_cast<TrapNode *>(node))
+            roots.push_back(trap);
+    }
+}
+
+/**
+ * Replaces a statement whose value is not used with the divisions in it. The statements are added
+ * to kept backwards
+ * */
+static void keepTraps(ASTNode *expression, vector<ASTNode *> &kept, vector<char> &live)
+{
+    vector<ASTNode *> roots;
+    trapRoots(expression, roots);
+
+    for (auto root = roots.rbegin(); root != roots.rend(); root++)
+    {
+        addReads(*root, live);
+        kept.push_back(*root);
+    }
+}
+
+/**
+ * Removes the dead assignments of the statements. live holds the variables live after the
+ * statements and is changed to the variables live in front of them
+ * */
+static void removeDeadStatements(vector<ASTNode *> &statements, vector<char> &live)
+{
+    vector<ASTNode *> kept;
+
+    for (auto statement = statements.rbegin(); statement != statements.rend(); statement++)
+    {
+        if (AssignNode *assign = dynamic_cast<AssignNode *>(*statement))
+        {
+            int slot = assign->identifier->slot;
+
+            if (!live[slot])
+            {
+                keepTraps(assign->expr, kept, live);
+                continue;
+            }
+
+            live[slot] = 0;
+            addReads(assign->expr, live);
+        }
+        else if (PrintNode *print = dynamic_cast<PrintNode *>(*statement))
+            addReads(print->expr, live);
+        else if (ConditionalNode *conditional = dynamic_cast<ConditionalNode *>(*statement))
+        {
+            //Only the variables the block assigns can stop being live in it
+            vector<int> assigned;
+            assignedSlots(conditional->statements, assigned);
+
+            vector<char> after;
+            for (int slot : assigned)
+                after.push_back(live[slot]);
+
+            if (conditional->type != 0)
+            {
+                //Everything the loop reads is taken to be live at its header, which holds for any iteration
+                addReads(conditional->condition, live);
+                addBlockReads(conditional->statements, live);
+
+                for (size_t i = 0; i < assigned.size(); i++)
+                    after[i] = live[assigned[i]];
+            }
+
+            removeDeadStatements(conditional->statements, live);
+
+            //The block may be skipped (or the loop left), so what is live after it stays live
+            for (size_t i = 0; i < assigned.size(); i++)
+                live[assigned[i]] |= after[i];
+
+            //An if with nothing left in its block only calculates its condition, an empty while still loops
+            if (conditional->type == 0 && conditional->statements.empty())
+            {
+                keepTraps(conditional->condition, kept, live);
+                continue;
+            }
+
+            addReads(conditional->condition, live);
+        }
+        else
+        {
+            keepTraps(*statement, kept, live);
+            continue;
+        }
+
+        kept.push_back(*statement);
+    }
+
+    statements.assign(kept.rbegin(), kept.rend());
+}
+
+/**
+ * Removes the assignments whose values are never read, after numberValues()
+ * */
+void removeDeadStores(vector<ASTNode *> &program, vector<string> &variables)
+{
+    vector<char> live(variables.size(), 0);
+    removeDeadStatements(program, live);
+}
@@ -1,18 +1,50 @@
-#include <unordered_set>
 #include <string>
+#include <unordered_map>
 #include <vector>
+#include <type_traits>
+#include <utility>
+#include <new>
 #include <fstream>
 #include <iostream>
 
 using namespace std;
 
+class BytecodeCompiler;
+class Columns;
+class Arena;
+
+/**
+ * Result of the code generation of an expression: an integer constant or the number of a temporary
+ * */
+struct Value
+{
+    bool temporary;
+    int number;
+};
+
+/**
+ * Name of a basic block, written as <kind>_<index><part> like cond_3body.
+ * Labels with a negative index are written as <kind> only
+ * */
+struct Label
+{
+    const char *kind;
+    int index;
+    const char *part;
+};
+
+class IREmitter;
+
 // Abstract class for Asynchronous Syntax Tree
 
 class ASTNode
 {
 public:
-    static int tempIndex;
-    virtual string generateCode(ofstream &output) = 0;
+    virtual Value generateCode(IREmitter &output) = 0;
+    virtual int evaluate(vector<int> &variables) = 0;
+    virtual int compile(BytecodeCompiler &compiler, int target) = 0;
+    virtual ASTNode *fold(Arena &arena) = 0;
+    virtual const int *evaluateColumns(Columns &columns, const int *mask) = 0;
  };
 
 /**
@@ -21,9 +53,14 @@ public:
 class IdentifierNode : public ASTNode
 {
 public:
-    string name;
-    IdentifierNode(string _name);
-    string generateCode(ofstream &output);
+    const char *name;
+    int slot; //index of the variable in Parser::variables and in the variables of every backend
+    IdentifierNode(const char *_name, int _slot);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
     string getID();
 };
 
@@ -34,9 +71,13 @@ public:
 class NumberNode : public ASTNode
 {
 public:
-    string value;
-    NumberNode(string _value);
-    string generateCode(ofstream &output);
+    int value;
+    NumberNode(int _value);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
 };
 
 /**
@@ -47,9 +88,12 @@ class ChooseNode : public ASTNode
 {
 public:
     ASTNode *expr1, *expr2, *expr3, *expr4;
-    static int chooseIndex;
     ChooseNode(ASTNode *_expr1, ASTNode *_expr2, ASTNode *_expr3, ASTNode *_expr4);
-    string generateCode(ofstream &output);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
 };
 
 /**
@@ -64,7 +108,46 @@ public:
     char operation;
 
     BinaryOperationNode(ASTNode *_left, ASTNode *_right, char _operation);
-    string generateCode(ofstream &output);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node for division by a constant divisor, fold() creates it from BinaryOperationNode.
+ * The division is calculated with a multiplication and shifts instead of a division instruction
+ * */
+class ConstantDivisionNode : public ASTNode
+{
+public:
+    ASTNode *dividend;
+    int divisor;    //anything but 0, 1 and -1
+    int multiplier; //0 if the absolute value of divisor is a power of two
+    int shift;
+
+    ConstantDivisionNode(ASTNode *_dividend, int _divisor);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node for a division that always traps, by zero or INT_MIN / -1. fold() creates it from
+ * BinaryOperationNode, the operands are dropped since the division traps whatever they calculate
+ * */
+class TrapNode : public ASTNode
+{
+public:
+    TrapNode();
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
 };
 
 /**
@@ -75,7 +158,11 @@ class PrintNode : public ASTNode
 public:
     ASTNode *expr;
     PrintNode(ASTNode *_expr);
-    string generateCode(ofstream &output);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
 };
 
 /**
@@ -85,13 +172,16 @@ public:
 class ConditionalNode : public ASTNode
 {
 public:
-    static int conditionalIndex;
     int type;
     ASTNode *condition;
     vector<ASTNode *> statements;
 
     ConditionalNode(int _type, ASTNode *_condition);
-    string generateCode(ofstream &output);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
 };
 
 /**
@@ -104,7 +194,66 @@ public:
     IdentifierNode *identifier;
     ASTNode *expr;
     AssignNode(IdentifierNode *id, ASTNode *expr);
-    string generateCode(ofstream &output);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Memory for everything created during one compilation: AST nodes and their strings.
+ * Memory is handed out from large blocks and released all at once by reset() or the destructor,
+ * objects that need a destructor call (like the statement vector of ConditionalNode) are
+ * remembered and destroyed at that point.
+ * */
+class Arena
+{
+public:
+    struct Cleanup
+    {
+        void (*destroy)(void *object);
+        void *object;
+        Cleanup *next;
+    };
+
+    vector<pair<char *, size_t>> blocks;
+    char *position; //free part of the current block
+    char *limit;
+    size_t blockSize;
+    Cleanup *cleanups;
+
+    size_t allocations;
+    size_t bytesAllocated; //bytes handed out since the last reset
+    size_t peakBytes;      //largest value of bytesAllocated
+    size_t bytesReserved;  //size of all blocks
+
+    Arena(size_t _blockSize = 1 << 16);
+    ~Arena();
+
+    void *allocate(size_t size, size_t alignment = alignof(void *));
+    const char *copyString(const string &text);
+    void reset();
+
+    /**
+     * Creates an object in the arena
+     * */
+    template <typename T, typename... Args>
+    T *make(Args &&... args)
+    {
+        T *object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+
+        if (!is_trivially_destructible<T>::value)
+        {
+            Cleanup *cleanup = (Cleanup *)allocate(sizeof(Cleanup), alignof(Cleanup));
+            cleanup->destroy = [](void *object) { ((T *)object)->~T(); };
+            cleanup->object = object;
+            cleanup->next = cleanups;
+            cleanups = cleanup;
+        }
+
+        return object;
+    }
 };
 
 enum TokenType
@@ -119,24 +268,68 @@ enum TokenType
     token_eof
 };
 
+/**
+ * Operator tokens, the value of each operator is its character
+ * */
+enum OperatorType : char
+{
+    operator_plus = '+',
+    operator_minus = '-',
+    operator_multiply = '*',
+    operator_divide = '/',
+    operator_assign = '=',
+    operator_comma = ',',
+    operator_open_paren = '(',
+    operator_close_paren = ')',
+    operator_open_brace = '{',
+    operator_close_brace = '}'
+};
+
 struct Token
 {
-    string value;
     TokenType type;
     int line;
+    union
+    {
+        OperatorType op; //token_operator, any other character is stored as it is
+        int symbol;      //token_identifier, index of the name in the symbol table
+        int number;      //token_number, value of the literal truncated to i32
+        int conditional; //token_conditional, 0 for if and 1 for while
+    };
+};
+
+/**
+ * Interns identifiers. Every distinct name gets the next symbol index and is stored once in the arena,
+ * the hash table is looked up with the characters in the input buffer so no string is created.
+ * */
+class SymbolTable
+{
+public:
+    Arena *arena;
+    vector<const char *> names;
+    vector<unsigned> hashes;
+    vector<int> lengths;
+    vector<int> table; //open addressing, holds symbol indexes or -1
+
+    SymbolTable(Arena *_arena);
+
+    int intern(const char *text, int length);
 };
 
 class Tokenizer
 {
 public:
-    ifstream *inputFile;
+    const char *cursor; //next character to read
+    const char *end;
+    bool eof;           //set when a character is read past the end of the input
     char lastChar;
     int line;
 
-    Tokenizer(ifstream *inputFile);
-    ~Tokenizer();
+    SymbolTable symbols;
+
+    Tokenizer(const char *input, size_t size, Arena *arena);
 
-    // void tokenizeInput(ifstream &input);
+    void nextChar();
     Token getNextToken();
 };
 
@@ -145,39 +338,38 @@ class Parser
 {
 public:
     Tokenizer *tokenizer;
+    Arena *arena; //owns all nodes created by the parser
     int line, errLine;
     bool error;
-    unordered_set<string> variables;
+    vector<string> variables; //declared variables in the order they first appear, their index is their slot
+    vector<int> slots;        //slot of every symbol, -1 for symbols that are not declared yet
     Token currentToken, lastToken;
 
-    Parser(Tokenizer *_tokenizer);
+    Parser(Tokenizer *_tokenizer, Arena *_arena);
 
     ASTNode *parseParanExpr();
-    ASTNode *parseFactor();
-    ASTNode *parseMorefactor();
-    ASTNode *parseTerm();
     ASTNode *parsePrint();
-    ASTNode *parseChoose();
-    ASTNode *parseMoreterms();
     ASTNode *parseExpr();
     ASTNode *parseStatement();
     ASTNode *parse();
 
     void syntaxError(int line);
     Token getToken();
+    bool isOperator(OperatorType op);
+    int declare(int symbol);
 };
 
-int ASTNode::tempIndex = 0;
-int ConditionalNode::conditionalIndex = 0;
-int ChooseNode::chooseIndex = 0;
-
 /**
  * Constructor for Parser class
  * */
-Parser::Parser(Tokenizer *_tokenizer)
+Parser::Parser(Tokenizer *_tokenizer, Arena *_arena)
 {
     this->tokenizer = _tokenizer;
+    this->arena = _arena;
     this->error = false;
+
+    //No token is read yet, parse() reads the first one like it does after an end of line
+    this->currentToken.type = token_eol;
 }
 
 /**
@@ -199,6 +391,31 @@ Token Parser::getToken()
     return tok;
 }
 
+/**
+ * Checks if the current token is the given operator
+ * */
+bool Parser::isOperator(OperatorType op)
+{
+    return currentToken.type == token_operator && currentToken.op == op;
+}
+
+/**
+ * Adds the variable of the symbol to the variable list if it is not there yet, returns its slot
+ * */
+int Parser::declare(int symbol)
+{
+    if (symbol >= (int)slots.size())
+        slots.resize(symbol + 1, -1);
+
+    if (slots[symbol] < 0)
+    {
+        slots[symbol] = variables.size();
+        variables.push_back(tokenizer->symbols.names[symbol]);
+    }
+
+    return slots[symbol];
+}
+
 ////////////////////////////////////////////////////////
 //// GRAMMAR PARSE FUNCTIONS
 ////////////////////////////////////////////////////////
@@ -215,7 +432,7 @@ ASTNode *Parser::parseParanExpr()
     ASTNode *node = parseExpr();
 
     //Checks if existence of closing bracket
-    if (currentToken.value != ")")
+    if (!isOperator(operator_close_paren))
     {
         syntaxError(line);
         return NULL;
@@ -228,148 +445,147 @@ ASTNode *Parser::parseParanExpr()
 }
 
 /**
- * Parses the given choose function with recursive descent
- * <choose> ::= "choose("<expression>"," <expression"," <expression>"," <expression>")"
+ * Returns the precedence of a binary operator, higher binds tighter, or 0 for any other character
  * */
-ASTNode *Parser::parseChoose()
+static int precedence(char op)
 {
-    currentToken = getToken(); //gets next token
-
-    //checks if it is ( otherwise throws syntax error
-    if (currentToken.value == "(")
+    switch (op)
     {
-        currentToken = getToken(); //gets next token
-        ASTNode *expr1 = parseExpr(); //parse first <expression>
-
-        if (currentToken.value == ",") //checks if "," exists, otherwise throw syntax error
-        {
-            currentToken = getToken();
-            ASTNode *expr2 = parseExpr(); //parse second <expression>
-
-            if (currentToken.value == ",") //checks if "," exists, otherwise throw syntax error
-            {
-                currentToken = getToken();
-                ASTNode *expr3 = parseExpr(); //parse third <expression>
-
-                if (currentToken.value == ",") //checks if "," exists, otherwise throw syntax error
-                {
-                    currentToken = getToken(); //gets next token
-                    ASTNode *expr4 = parseExpr(); //parse forth <expression>
-
-                    if (currentToken.value == ")") //checks if ")" exists, otherwise throw syntax error
-                    {
-                        return new ChooseNode(expr1, expr2, expr3, expr4);
-                    }
-                }
-            }
-        }
+    case ('+'):
+    case ('-'):
+        return 1;
+    case ('*'):
+    case ('/'):
+        return 2;
+    default:
+        return 0;
     }
-
-    syntaxError(line);
-    return NULL;
 }
 
 /**
- * Parses the given grammar
- * <factor> ::= <identifier> | <integer> | "("<expression>")"| <choose>
+ * Parses an <expression> with operator precedence parsing on explicit stacks instead of recursive
+ * descent, so expressions can be nested as deep as memory allows. Operators wait on the stack until
+ * an operator with the same or lower precedence (or the end of the expression) combines them with
+ * their operands, which makes all operators left associative. "(" and "choose(" open a frame that
+ * the matching ")" closes, commas separate the expressions of a choose.
+ * <expression> ::= <term> { ("+" | "-") <term> }
+ * <term>       ::= <factor> { ("*" | "/") <factor> }
+ * <factor>     ::= <identifier> | <integer> | "("<expression>")" | <choose>
+ * <choose>     ::= "choose("<expression>","<expression>","<expression>","<expression>")"
  * */
-ASTNode *Parser::parseFactor()
+ASTNode *Parser::parseExpr()
 {
-
-    //Checks if the grammar is <factor> ::= (<expression>)
-    if (currentToken.value == "(")
-        return parseParanExpr(); //Parses given grammar
-
-    ASTNode *node = NULL;
-
-    //Checks token types
-    switch (currentToken.type)
+    //An operator, or an open frame: '(' for parentheses and 'c' for a choose with the number of commas read
+    struct Pending
     {
-    case (token_choose):           //<factor> ::= <choose>
-        node = parseChoose();      //parses <choose>
-        currentToken = getToken(); //gets next token
-        return node;
+        char symbol;
+        int commas;
+    };
 
-    case (token_number):                           //<factor> ::= <integer>
-        node = new NumberNode(currentToken.value); //Creates ASTNode for <integer>
-        currentToken = getToken();                 //gets next token
-        return node;
+    //The stacks are kept between expressions, an expression that ends with a syntax error leaves them dirty
+    static thread_local vector<ASTNode *> operands;
+    static thread_local vector<Pending> pending;
 
-    case (token_identifier):                  //<factor> ::= <identifier>
-        variables.insert(currentToken.value); //pushes the variable if it is not located there
+    operands.clear();
+    pending.clear();
 
-        node = new IdentifierNode(currentToken.value); //creates ASTNode for <identifier>
-        currentToken = getToken();                     //gets next token
-        return node;
-
-    default: //if the token is not any of the given it should be syntax error
-        syntaxError(line);
-        return node;
-    }
-}
+    //Combines the operators on top of the stack that have at least the given precedence with their operands
+    auto reduce = [&](int minimum) {
+        while (!pending.empty() && precedence(pending.back().symbol) >= minimum)
+        {
+            ASTNode *right = operands.back();
+            operands.pop_back();
+            operands.back() = arena->make<BinaryOperationNode>(operands.back(), right, pending.back().symbol);
+            pending.pop_back();
+        }
+    };
 
-/**
- * Parses given <term> grammar with recursive descent
- * <term> ::= <factor> "*" <term> | <factor> "/" <term> | <factor>
- * */
-ASTNode *Parser::parseTerm()
-{
-    //Parses the left side <factor>
-    ASTNode *node = parseFactor();
+    for (;;)
+    {
+        //Opening parentheses and chooses come before the operand
+        if (isOperator(operator_open_paren))
+        {
+            pending.push_back(Pending{'(', 0});
+            currentToken = getToken();
+            continue;
+        }
 
-    //Left side parse is not successful, exit function
-    if (node == NULL)
-        return node;
+        if (currentToken.type == token_choose)
+        {
+            currentToken = getToken();
 
-    //Checks if the operator is "*" or "*" and recursively parses <factor> on right side of operators
-    //this creates a tree as it calls and stores lower functions recursively
-    while (currentToken.value == "*" || currentToken.value == "/")
-    {
-        string opSign = currentToken.value; //Store operation sign
-        currentToken = getToken();          //gets next token
+            if (!isOperator(operator_open_paren))
+            {
+                syntaxError(line);
+                return NULL;
+            }
 
-        ASTNode *expr = parseFactor(); //Parse right side of operator for <factor>
+            pending.push_back(Pending{'c', 0});
+            currentToken = getToken();
+            continue;
+        }
 
-        //If parsing right side parse is not successfull exit function
-        if (expr == NULL)
+        if (currentToken.type == token_number)
+            operands.push_back(arena->make<NumberNode>(currentToken.number));
+        else if (currentToken.type == token_identifier)
+        {
+            int slot = declare(currentToken.symbol); //pushes the variable if it is not located there
+            operands.push_back(arena->make<IdentifierNode>(tokenizer->symbols.names[currentToken.symbol], slot));
+        }
+        else
+        {
+            syntaxError(line);
             return NULL;
+        }
 
-        //create operation node and assign it to node
-        node = new BinaryOperationNode(node, expr, opSign[0]);
-    }
+        currentToken = getToken();
 
-    return node;
-}
+        //Closes frames after the operand till an operator asks for the next operand
+        for (;;)
+        {
+            if (currentToken.type == token_operator && precedence(currentToken.op) > 0)
+            {
+                reduce(precedence(currentToken.op));
+                pending.push_back(Pending{currentToken.op, 0});
+                currentToken = getToken();
+                break;
+            }
 
-/**
- * Parses given <expression> grammar with recursive descent
- * <expression> ::= <term> "+" <expression> | <term> "-" <expression> | <term>
- * */
-ASTNode *Parser::parseExpr()
-{
-    //Parses the left side <term>
-    ASTNode *node = parseTerm();
+            //Anything else ends the innermost frame or the expression
+            reduce(1);
 
-    //Left side parse is not successful, exit function
-    if (node == NULL)
-        return node;
+            //The token after the expression is checked by the caller
+            if (pending.empty())
+                return operands.back();
 
-    //this creates a tree as it calls and stores lower functions recursively
-    while (currentToken.value == "*" || currentToken.value == "/")
-    {
-        string opSign = currentToken.value; //Store operation sign
-        currentToken = getToken();          //get next token
+            Pending &frame = pending.back();
 
-        ASTNode *expr = parseTerm(); //parse the right side
+            if (isOperator(operator_comma) && frame.symbol == 'c' && frame.commas < 3)
+            {
+                frame.commas++;
+                currentToken = getToken();
+                break;
+            }
 
-        //Right side parse is not successfull exit function
-        if (expr == NULL)
-            return NULL;
+            if (!isOperator(operator_close_paren) || (frame.symbol == 'c' && frame.commas < 3))
+            {
+                syntaxError(line);
+                return NULL;
+            }
+
+            if (frame.symbol == 'c')
+            {
+                ASTNode **expressions = &operands[operands.size() - 4];
+                ASTNode *choose = arena->make<ChooseNode>(expressions[0], expressions[1], expressions[2], expressions[3]);
+
+                operands.resize(operands.size() - 3);
+                operands.back() = choose;
+            }
 
-        //create operation node
-        node = new BinaryOperationNode(node, expr, opSign[0]);
+            pending.pop_back();
+            currentToken = getToken();
+        }
     }
-    return node;
 }
 
 /**
@@ -380,9 +596,9 @@ ASTNode *Parser::parsePrint()
 {
     currentToken = getToken(); //gets next token
 
-    if (currentToken.value == "(") //checks if ( exists otherwise throw error
+    if (isOperator(operator_open_paren)) //checks if ( exists otherwise throw error
     {
-        return new PrintNode(parseParanExpr()); //parse the expression inside parentheses
+        return arena->make<PrintNode>(parseParanExpr()); //parse the expression inside parentheses
     }
 
     syntaxError(line);
@@ -395,7 +611,7 @@ ASTNode *Parser::parsePrint()
  * */
 ASTNode *Parser::parseStatement()
 {
-    string value = currentToken.value;
+    int symbol = currentToken.symbol;
 
     //
     switch (currentToken.type)
@@ -408,14 +624,14 @@ ASTNode *Parser::parseStatement()
 
         currentToken = getToken(); //get next token
 
-        if (currentToken.value == "=") //checks if it is assignment otherwise throw error
+        if (isOperator(operator_assign)) //checks if it is assignment otherwise throw error
         {
-            IdentifierNode *id = new IdentifierNode(value); //create ID node for left side
-            this->variables.insert(value);                  //add to the variable list if it doesn't exist
+            int slot = declare(symbol);                                                        //add to the variable list if it doesn't exist
+            IdentifierNode *id = arena->make<IdentifierNode>(tokenizer->symbols.names[symbol], slot); //create ID node for left side
 
             currentToken = getToken(); //get next token
 
-            return new AssignNode(id, parseExpr()); //parse right side of '='
+            return arena->make<AssignNode>(id, parseExpr()); //parse right side of '='
         }
 
         syntaxError(line);
@@ -435,12 +651,6 @@ ASTNode *Parser::parseStatement()
  * */
 ASTNode *Parser::parse()
 {
-    //Checks if currentToken is empty
-    if (currentToken.value == "")
-    {
-        currentToken = getToken(); //If empty get new
-    }
-
     //Checks token type
     switch (currentToken.type)
     {
@@ -455,11 +665,11 @@ ASTNode *Parser::parse()
         /**
          * Checks the type of conditional, if it is not if or while returns syntax error
          * */
-        if (currentToken.value == "if")
+        if (currentToken.conditional == 0)
         {
             type = 0;
         }
-        else if (currentToken.value == "while")
+        else if (currentToken.conditional == 1)
         {
             type = 1;
         }
@@ -472,13 +682,13 @@ ASTNode *Parser::parse()
         currentToken = getToken(); //gets new token after if or while
 
         //Checks if the token is ( otherwise throws syntax error
-        if (currentToken.value == "(")
+        if (isOperator(operator_open_paren))
         {
             //Parses expression inside parantheses
             ASTNode *condition = parseParanExpr();
 
             //Creates ASTNode to store conditional and expressions
-            ConditionalNode *cond = new ConditionalNode(type, condition);
+            ConditionalNode *cond = arena->make<ConditionalNode>(type, condition);
 
             //If the current token is \n get new token
             while (currentToken.type == token_eol)
@@ -487,7 +697,7 @@ ASTNode *Parser::parse()
             }
 
             //checks "{" otherwise throws syntax error
-            if (currentToken.value == "{")
+            if (isOperator(operator_open_brace))
             {
                 currentToken = getToken(); //gets next token
 
@@ -497,7 +707,7 @@ ASTNode *Parser::parse()
                     currentToken = getToken();
                 }
                 //Parse expressions till there is a '}' symbol found or there is no error found
-                while (currentToken.value != "}" && !this->error)
+                while (!isOperator(operator_close_brace) && !this->error)
                 {
                     ASTNode *temp = parseStatement(); //Parses statements inside {} block and adds them to ASTNode
 
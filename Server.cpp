@@ -0,0 +1,1037 @@
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <deque>
+#include <type_traits>
+#include <utility>
+#include <new>
+#include <functional>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <chrono>
+#include <iomanip>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdarg>
+#include <cstring>
+#include <cerrno>
+#include <csetjmp>
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <unistd.h>
+
+using namespace std;
+
+class BytecodeCompiler;
+class Columns;
+class Arena;
+
+/**
+ * Result of the code generation of an expression: an integer constant or the number of a temporary
+ * */
+struct Value
+{
+    bool temporary;
+    int number;
+};
+
+/**
+ * Name of a basic block, written as <kind>_<index><part> like cond_3body.
+ * Labels with a negative index are written as <kind> only
+ * */
+struct Label
+{
+    const char *kind;
+    int index;
+    const char *part;
+};
+
+class IREmitter;
+
+// Abstract class for Asynchronous Syntax Tree
+
+class ASTNode
+{
+public:
+    virtual Value generateCode(IREmitter &output) = 0;
+    virtual int evaluate(vector<int> &variables) = 0;
+    virtual int compile(BytecodeCompiler &compiler, int target) = 0;
+    virtual ASTNode *fold(Arena &arena) = 0;
+    virtual const int *evaluateColumns(Columns &columns, const int *mask) = 0;
+ };
+
+/**
+ * Stores identifier of variables. Can generate code with temp variables
+ * */
+class IdentifierNode : public ASTNode
+{
+public:
+    const char *name;
+    int slot; //index of the variable in Parser::variables and in the variables of every backend
+    IdentifierNode(const char *_name, int _slot);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+    string getID();
+};
+
+
+/**
+ * Stores values for numbers. generateCode() function returns the integer value
+ * */
+class NumberNode : public ASTNode
+{
+public:
+    int value;
+    NumberNode(int _value);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node for choose expression, stores the expressions inside parantheses. 
+ * Generates code for both expressions and choose function.
+ * */
+class ChooseNode : public ASTNode
+{
+public:
+    ASTNode *expr1, *expr2, *expr3, *expr4;
+    ChooseNode(ASTNode *_expr1, ASTNode *_expr2, ASTNode *_expr3, ASTNode *_expr4);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node for binary operations. Stores the operation type, right and left handside as expressions
+ * and generates code for the calculation
+ * */
+class BinaryOperationNode : public ASTNode
+{
+public:
+    ASTNode *left;
+    ASTNode *right;
+    char operation;
+
+    BinaryOperationNode(ASTNode *_left, ASTNode *_right, char _operation);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node for division by a constant divisor, fold() creates it from BinaryOperationNode.
+ * The division is calculated with a multiplication and shifts instead of a division instruction
+ * */
+class ConstantDivisionNode : public ASTNode
+{
+public:
+    ASTNode *dividend;
+    int divisor;    //anything but 0, 1 and -1
+    int multiplier; //0 if the absolute value of divisor is a power of two
+    int shift;
+
+    ConstantDivisionNode(ASTNode *_dividend, int _divisor);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node for a division that always traps, by zero or INT_MIN / -1. fold() creates it from
+ * BinaryOperationNode, the operands are dropped since the division traps whatever they calculate
+ * */
+class TrapNode : public ASTNode
+{
+public:
+    TrapNode();
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node for print statements. Generates code for print statement and expression inside the statement
+ * */
+class PrintNode : public ASTNode
+{
+public:
+    ASTNode *expr;
+    PrintNode(ASTNode *_expr);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node to store conditional statements. Stores the condition, conditional type and statements
+ * inside the code block and generates code for all of them
+ * */
+class ConditionalNode : public ASTNode
+{
+public:
+    int type;
+    ASTNode *condition;
+    vector<ASTNode *> statements;
+
+    ConditionalNode(int _type, ASTNode *_condition);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Node for assignment statement. Stores identifier and expression 
+ * Generates code for assignment statement
+ * */
+class AssignNode : public ASTNode
+{
+public:
+    IdentifierNode *identifier;
+    ASTNode *expr;
+    AssignNode(IdentifierNode *id, ASTNode *expr);
+    Value generateCode(IREmitter &output);
+    int evaluate(vector<int> &variables);
+    int compile(BytecodeCompiler &compiler, int target);
+    ASTNode *fold(Arena &arena);
+    const int *evaluateColumns(Columns &columns, const int *mask);
+};
+
+/**
+ * Memory for everything created during one compilation: AST nodes and their strings.
+ * Memory is handed out from large blocks and released all at once by reset() or the destructor,
+ * objects that need a destructor call (like the statement vector of ConditionalNode) are
+ * remembered and destroyed at that point.
+ * */
+class Arena
+{
+public:
+    struct Cleanup
+    {
+        void (*destroy)(void *object);
+        void *object;
+        Cleanup *next;
+    };
+
+    vector<pair<char *, size_t>> blocks;
+    char *position; //free part of the current block
+    char *limit;
+    size_t blockSize;
+    Cleanup *cleanups;
+
+    size_t allocations;
+    size_t bytesAllocated; //bytes handed out since the last reset
+    size_t peakBytes;      //largest value of bytesAllocated
+    size_t bytesReserved;  //size of all blocks
+
+    Arena(size_t _blockSize = 1 << 16);
+    ~Arena();
+
+    void *allocate(size_t size, size_t alignment = alignof(void *));
+    const char *copyString(const string &text);
+    void reset();
+
+    /**
+     * Creates an object in the arena
+     * */
+    template <typename T, typename... Args>
+    T *make(Args &&... args)
+    {
+        T *object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+
+        if (!is_trivially_destructible<T>::value)
+        {
+            Cleanup *cleanup = (Cleanup *)allocate(sizeof(Cleanup), alignof(Cleanup));
+            cleanup->destroy = [](void *object) { ((T *)object)->~T(); };
+            cleanup->object = object;
+            cleanup->next = cleanups;
+            cleanups = cleanup;
+        }
+
+        return object;
+    }
+};
+
+enum TokenType
+{
+    token_identifier,
+    token_number,
+    token_operator,
+    token_print,
+    token_choose,
+    token_conditional,
+    token_eol,
+    token_eof
+};
+
+/**
+ * Operator tokens, the value of each operator is its character
+ * */
+enum OperatorType : char
+{
+    operator_plus = '+',
+    operator_minus = '-',
+    operator_multiply = '*',
+    operator_divide = '/',
+    operator_assign = '=',
+    operator_comma = ',',
+    operator_open_paren = '(',
+    operator_close_paren = ')',
+    operator_open_brace = '{',
+    operator_close_brace = '}'
+};
+
+struct Token
+{
+    TokenType type;
+    int line;
+    union
+    {
+        OperatorType op; //token_operator, any other character is stored as it is
+        int symbol;      //token_identifier, index of the name in the symbol table
+        int number;      //token_number, value of the literal truncated to i32
+        int conditional; //token_conditional, 0 for if and 1 for while
+    };
+};
+
+/**
+ * Interns identifiers. Every distinct name gets the next symbol index and is stored once in the arena,
+ * the hash table is looked up with the characters in the input buffer so no string is created.
+ * */
+class SymbolTable
+{
+public:
+    Arena *arena;
+    vector<const char *> names;
+    vector<unsigned> hashes;
+    vector<int> lengths;
+    vector<int> table; //open addressing, holds symbol indexes or -1
+
+    SymbolTable(Arena *_arena);
+
+    int intern(const char *text, int length);
+};
+
+class Tokenizer
+{
+public:
+    const char *cursor; //next character to read
+    const char *end;
+    bool eof;           //set when a character is read past the end of the input
+    char lastChar;
+    int line;
+
+    SymbolTable symbols;
+
+    Tokenizer(const char *input, size_t size, Arena *arena);
+
+    void nextChar();
+    Token getNextToken();
+};
+
+
+class Parser
+{
+public:
+    Tokenizer *tokenizer;
+    Arena *arena; //owns all nodes created by the parser
+    int line, errLine;
+    bool error;
+    vector<string> variables; //declared variables in the order they first appear, their index is their slot
+    vector<int> slots;        //slot of every symbol, -1 for symbols that are not declared yet
+    Token currentToken, lastToken;
+
+    Parser(Tokenizer *_tokenizer, Arena *_arena);
+
+    ASTNode *parseParanExpr();
+    ASTNode *parsePrint();
+    ASTNode *parseExpr();
+    ASTNode *parseStatement();
+    ASTNode *parse();
+
+    void syntaxError(int line);
+    Token getToken();
+    bool isOperator(OperatorType op);
+    int declare(int symbol);
+};
+
+void generateIR(ostream &file, vector<ASTNode *> &program, vector<string> &varmap);
+void foldConstants(vector<ASTNode *> &program, Arena &arena);
+void numberValues(vector<ASTNode *> &program, vector<string> &variables, Arena &arena);
+void removeDeadStores(vector<ASTNode *> &program, vector<string> &variables);
+void parseProgram(Parser *parser, vector<ASTNode *> &program);
+void *llvmBackend(const char *name);
+
+class Bytecode;
+
+Bytecode *compileBytecode(vector<ASTNode *> &program, vector<string> &variables);
+void runBytecode(Bytecode *bytecode);
+void deleteBytecode(Bytecode *bytecode);
+
+extern thread_local FILE *programOutput; //where print writes, stdout when NULL
+
+typedef void *(*CompileJITFunction)(const string &ir, void *printFunction, int (**mainFunction)(), vector<pair<string, double>> &timings);
+typedef void (*ReleaseJITFunction)(void *jit);
+
+double elapsedMs(chrono::steady_clock::time_point start);
+
+/****************
+ * Traps
+ *
+ * A division by zero raises SIGFPE in the process that runs the program. The handler jumps back to
+ * runTrapped(), so the output printed so far can still be sent back with the TRAP status.
+ * **************/
+
+static thread_local sigjmp_buf *trapJump = NULL; //set while the thread runs program code
+
+static void trapHandler(int number)
+{
+    //A division by zero outside of program code ends the process as usual
+    if (trapJump == NULL)
+    {
+        signal(number, SIG_DFL);
+        return;
+    }
+
+    siglongjmp(*trapJump, 1);
+}
+
+/**
+ * Runs program code, returns false if a division by zero stopped it
+ * */
+static bool runTrapped(const function<void()> &code)
+{
+    sigjmp_buf jump;
+
+    if (sigsetjmp(jump, 1) != 0)
+    {
+        trapJump = NULL;
+        return false;
+    }
+
+    trapJump = &jump;
+    code();
+    trapJump = NULL;
+
+    return true;
+}
+
+/****************
+ * Isolation
+ *
+ * Every program runs in a child process forked from the thread that serves the request, once it is
+ * compiled. A program that overflows the stack or crashes only ends its child, and one that runs
+ * longer than the time limit is killed, so the server and the other requests keep running. The
+ * child sends what the program printed back through a pipe.
+ * **************/
+
+static const int trapExitStatus = 3; //exit status of a child stopped by a division by zero
+
+//Held while a pipe has its write end open in the server, so that no other child inherits it and
+//keeps the pipe open after the program that writes to it ended
+static mutex forkLock;
+
+/**
+ * Runs program code in a child process and sets output to what it printed. Returns OK, TRAP if a
+ * division by zero stopped it, or ERROR if it crashed or ran longer than timeLimit milliseconds; the
+ * output is then the error message
+ * */
+static string runIsolated(const function<void()> &code, int timeLimit, string &output)
+{
+    int channel[2];
+    pid_t child = -1;
+
+    {
+        lock_guard<mutex> guard(forkLock);
+
+        if (pipe(channel) != 0)
+        {
+            output = string("can not create a pipe: ") + strerror(errno) + "\n";
+            return "ERROR";
+        }
+
+        child = fork();
+
+        if (child == 0)
+        {
+            close(channel[0]);
+            programOutput = fdopen(channel[1], "w");
+
+            bool completed = runTrapped(code);
+
+            fclose(programOutput);
+            _exit(completed ? 0 : trapExitStatus);
+        }
+
+        close(channel[1]);
+    }
+
+    if (child < 0)
+    {
+        close(channel[0]);
+        output = string("can not start a process: ") + strerror(errno) + "\n";
+        return "ERROR";
+    }
+
+    auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeLimit);
+    bool timedOut = false;
+    char block[1 << 16];
+
+    output.clear();
+
+    //Reads until the child closes the pipe when it ends
+    for (;;)
+    {
+        long long remaining = chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count();
+        pollfd readable = {channel[0], POLLIN, 0};
+        int ready = remaining > 0 ? poll(&readable, 1, (int)remaining) : 0;
+
+        if (ready < 0 && errno == EINTR)
+            continue;
+
+        if (ready == 0)
+        {
+            timedOut = true;
+            kill(child, SIGKILL);
+            break;
+        }
+
+        ssize_t count = read(channel[0], block, sizeof(block));
+
+        if (count < 0 && errno == EINTR)
+            continue;
+
+        if (count <= 0)
+            break;
+
+        output.append(block, count);
+    }
+
+    close(channel[0]);
+
+    int childStatus = 0;
+
+    while (waitpid(child, &childStatus, 0) < 0 && errno == EINTR)
+        ;
+
+    if (timedOut)
+    {
+        output = "the program ran longer than the time limit of " + to_string(timeLimit) + " ms\n";
+        return "ERROR";
+    }
+
+    if (WIFEXITED(childStatus) && WEXITSTATUS(childStatus) == 0)
+        return "OK";
+
+    if (WIFEXITED(childStatus) && WEXITSTATUS(childStatus) == trapExitStatus)
+        return "TRAP";
+
+    output = string("the program crashed: ") + (WIFSIGNALED(childStatus) ? strsignal(WTERMSIG(childStatus)) : "unknown exit status") + "\n";
+    return "ERROR";
+}
+
+/**
+ * printf of the programs run by the JIT, writes to the output of the request like print does in the evaluator
+ * */
+static int printOutput(const char *format, ...)
+{
+    va_list arguments;
+
+    va_start(arguments, format);
+    int count = vfprintf(programOutput != NULL ? programOutput : stdout, format, arguments);
+    va_end(arguments);
+
+    return count;
+}
+
+/****************
+ * Statistics
+ * **************/
+
+static const int latencyBuckets = 32;
+
+// Requests run with one engine. Bucket i counts the requests that took less than 2^i microseconds,
+// the last bucket also counts the slower ones
+struct Latencies
+{
+    long long requests, traps, errors;
+    double totalMs;
+    long long buckets[latencyBuckets];
+};
+
+// Latencies of all requests of the server, by engine
+class Statistics
+{
+public:
+    mutex lock;
+    unordered_map<string, Latencies> engines;
+
+    void add(const string &engine, double milliseconds, const string &status);
+    string report();
+};
+
+void Statistics::add(const string &engine, double milliseconds, const string &status)
+{
+    int bucket = 0;
+
+    while (bucket < latencyBuckets - 1 && milliseconds * 1000 >= (double)(1LL << bucket))
+        bucket++;
+
+    lock_guard<mutex> guard(lock);
+    Latencies &latencies = engines[engine]; //a new entry starts with all counts 0
+
+    latencies.requests++;
+    latencies.traps += status == "TRAP";
+    latencies.errors += status == "ERROR";
+    latencies.totalMs += milliseconds;
+    latencies.buckets[bucket]++;
+}
+
+/**
+ * Returns the number of requests, traps and errors of every engine, the mean latency, the 50th, 90th and 99th
+ * percentile (as the upper bound of the bucket they fall in) and the histogram of the latencies
+ * */
+string Statistics::report()
+{
+    lock_guard<mutex> guard(lock);
+    ostringstream output;
+
+    output << fixed << setprecision(3);
+
+    for (const char *engine : {"eval", "vm", "jit"})
+    {
+        auto found = engines.find(engine);
+
+        if (found == engines.end())
+            continue;
+
+        Latencies &latencies = found->second;
+
+        output << engine << ": " << latencies.requests << " requests, " << latencies.traps << " traps, " << latencies.errors
+               << " errors, mean " << latencies.totalMs / latencies.requests << " ms";
+
+        for (int percentile : {50, 90, 99})
+        {
+            long long rank = (latencies.requests * percentile + 99) / 100, count = 0;
+            int bucket = 0;
+
+            while ((count += latencies.buckets[bucket]) < rank)
+                bucket++;
+
+            output << ", p" << percentile << " < " << (1LL << bucket) / 1000.0 << " ms";
+        }
+
+        output << "\n";
+
+        for (int bucket = 0; bucket < latencyBuckets; bucket++)
+        {
+            if (latencies.buckets[bucket] != 0)
+                output << "  < " << setw(12) << (1LL << bucket) / 1000.0 << " ms " << setw(10) << latencies.buckets[bucket] << "\n";
+        }
+    }
+
+    return output.str();
+}
+
+/****************
+ * Requests
+ * **************/
+
+/**
+ * Compiles the program and runs it with the engine (eval, vm or jit) in a child process, returns what
+ * it printed. status is set to OK, TRAP if a division by zero stopped the program, or ERROR if it could
+ * not be compiled, crashed or ran longer than timeLimit milliseconds; the output is then the error message
+ * */
+static string runRequest(const string &engine, const string &source, int timeLimit, string &status)
+{
+    Arena arena;
+    Tokenizer tokenizer(source.data(), source.size(), &arena);
+    Parser parser(&tokenizer, &arena);
+    vector<ASTNode *> program;
+
+    parseProgram(&parser, program);
+    status = "OK";
+
+    //All engines print only this for a syntax error
+    if (parser.error)
+        return "Line " + to_string(parser.errLine) + ": syntax error\n";
+
+    foldConstants(program, arena);
+    numberValues(program, parser.variables, arena);
+    removeDeadStores(program, parser.variables);
+
+    string output;
+
+    if (engine == "eval")
+    {
+        vector<int> variables(parser.variables.size());
+
+        status = runIsolated([&]() {
+            for (auto statement : program)
+                statement->evaluate(variables);
+        }, timeLimit, output);
+    }
+    else if (engine == "vm")
+    {
+        Bytecode *bytecode = compileBytecode(program, parser.variables);
+
+        status = runIsolated([&]() { runBytecode(bytecode); }, timeLimit, output);
+        deleteBytecode(bytecode);
+    }
+    else
+    {
+        CompileJITFunction compileJIT = (CompileJITFunction)llvmBackend("compileJIT");
+        ReleaseJITFunction releaseJIT = (ReleaseJITFunction)llvmBackend("releaseJIT");
+        vector<pair<string, double>> timings;
+        int (*mainFunction)() = NULL;
+        ostringstream ir;
+
+        generateIR(ir, program, parser.variables);
+        void *jit = compileJIT(ir.str(), (void *)printOutput, &mainFunction, timings);
+
+        if (jit != NULL)
+        {
+            status = runIsolated([&]() { mainFunction(); }, timeLimit, output);
+            releaseJIT(jit);
+        }
+        else
+        {
+            status = "ERROR";
+            output = "the JIT can not compile the program\n";
+        }
+    }
+
+    return output;
+}
+
+// One end of a connection, read in large blocks
+class Connection
+{
+public:
+    int socket;
+    string received; //read from the socket but not used yet
+
+    Connection(int _socket);
+
+    bool readLine(string &line);
+    bool read(size_t size, string &data);
+    bool write(const string &data);
+
+private:
+    bool receive();
+};
+
+Connection::Connection(int _socket)
+{
+    this->socket = _socket;
+}
+
+/**
+ * Reads more data into received, returns false at the end of the connection
+ * */
+bool Connection::receive()
+{
+    char block[1 << 16];
+    ssize_t count;
+
+    do
+        count = recv(socket, block, sizeof(block), 0);
+    while (count < 0 && errno == EINTR);
+
+    if (count <= 0)
+        return false;
+
+    received.append(block, count);
+    return true;
+}
+
+/**
+ * Reads the next line without its \n, returns false if the connection ends first
+ * */
+bool Connection::readLine(string &line)
+{
+    size_t end;
+
+    while ((end = received.find('\n')) == string::npos)
+    {
+        if (!receive())
+            return false;
+    }
+
+    line = received.substr(0, end);
+    received.erase(0, end + 1);
+    return true;
+}
+
+/**
+ * Reads exactly size bytes, returns false if the connection ends first
+ * */
+bool Connection::read(size_t size, string &data)
+{
+    while (received.size() < size)
+    {
+        if (!receive())
+            return false;
+    }
+
+    data = received.substr(0, size);
+    received.erase(0, size);
+    return true;
+}
+
+bool Connection::write(const string &data)
+{
+    for (size_t done = 0; done < data.size();)
+    {
+        ssize_t count = send(socket, data.data() + done, data.size() - done, MSG_NOSIGNAL);
+
+        if (count < 0 && errno == EINTR)
+            continue;
+
+        if (count <= 0)
+            return false;
+
+        done += count;
+    }
+
+    return true;
+}
+
+/**
+ * Answers the requests of one client until it closes the connection. A request is a line
+ * "RUN <engine> <size>" followed by size bytes of program text, or a line "STATS". Every answer
+ * is a line "<status> <size>" followed by size bytes of output
+ * */
+static void serveConnection(int socket, int timeLimit, Statistics &statistics)
+{
+    Connection connection(socket);
+    string line;
+
+    while (connection.readLine(line))
+    {
+        istringstream header(line);
+        string command, engine, source;
+        size_t size = 0;
+
+        header >> command;
+
+        if (command == "STATS")
+        {
+            string report = statistics.report();
+
+            if (!connection.write("OK " + to_string(report.size()) + "\n" + report))
+                break;
+
+            continue;
+        }
+
+        //A request that can not be understood ends the connection, the rest of it can not be read
+        if (command != "RUN" || !(header >> engine >> size) || (engine != "eval" && engine != "vm" && engine != "jit"))
+        {
+            string message = "bad request: " + line + "\n";
+            connection.write("ERROR " + to_string(message.size()) + "\n" + message);
+            break;
+        }
+
+        if (!connection.read(size, source))
+            break;
+
+        auto start = chrono::steady_clock::now();
+        string status;
+        string output = runRequest(engine, source, timeLimit, status);
+
+        statistics.add(engine, elapsedMs(start), status);
+
+        if (!connection.write(status + " " + to_string(output.size()) + "\n" + output))
+            break;
+    }
+
+    close(socket);
+}
+
+/****************
+ * Server and client entry points
+ * **************/
+
+/**
+ * Fills in the address of the socket at the path, returns false if the path is too long
+ * */
+static bool socketAddress(const string &path, sockaddr_un &address)
+{
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        cerr << "division-interpreter: socket path too long: " << path << "\n";
+        return false;
+    }
+
+    strcpy(address.sun_path, path.c_str());
+    return true;
+}
+
+/**
+ * Serves programs on a Unix domain socket at the path until the process is killed. Connections are
+ * queued and answered by a pool of jobs threads, each thread serves one connection at a time. A
+ * program is stopped with an error after timeLimit milliseconds.
+ * Returns 1 if the socket can not be opened
+ * */
+int runServer(const string &path, int jobs, int timeLimit)
+{
+    sockaddr_un address;
+
+    if (!socketAddress(path, address))
+        return 1;
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    //A socket file left by a server that was stopped is replaced
+    unlink(path.c_str());
+
+    if (listener < 0 || bind(listener, (sockaddr *)&address, sizeof(address)) != 0 || listen(listener, 128) != 0)
+    {
+        cerr << "division-interpreter: can not listen on " << path << ": " << strerror(errno) << "\n";
+        return 1;
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = trapHandler;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGFPE, &action, NULL);
+
+    //Loads the LLVM backend before the threads need it
+    llvmBackend("compileJIT");
+
+    Statistics statistics;
+    deque<int> pending;
+    mutex queueLock;
+    condition_variable queued;
+
+    auto worker = [&]() {
+        for (;;)
+        {
+            unique_lock<mutex> lock(queueLock);
+            queued.wait(lock, [&]() { return !pending.empty(); });
+
+            int client = pending.front();
+            pending.pop_front();
+            lock.unlock();
+
+            serveConnection(client, timeLimit, statistics);
+        }
+    };
+
+    for (int i = 0; i < jobs; i++)
+        thread(worker).detach();
+
+    cerr << "division-interpreter: serving on " << path << " with " << jobs << " threads\n";
+
+    for (;;)
+    {
+        int client = accept(listener, NULL, NULL);
+
+        if (client < 0 && errno == EINTR)
+            continue;
+
+        if (client < 0)
+        {
+            cerr << "division-interpreter: can not accept connections: " << strerror(errno) << "\n";
+            return 1;
+        }
+
+        lock_guard<mutex> lock(queueLock);
+        pending.push_back(client);
+        queued.notify_one();
+    }
+}
+
+/**
+ * Sends the input file to the server to be run with the engine, or asks for the statistics of the
+ * server, and prints the answer. A program stopped by a division by zero raises SIGFPE here after
+ * its output is printed, like it does when it runs in this process.
+ * Returns 0, or 1 if the server can not be reached or answers with an error
+ * */
+int runClient(const string &path, const string &engine, const string &inputFile, bool stats)
+{
+    string request = "STATS\n";
+
+    if (!stats)
+    {
+        ifstream input(inputFile, ios::binary);
+        ostringstream source;
+
+        if (!(source << input.rdbuf()))
+        {
+            cerr << "division-interpreter: can not read " << inputFile << "\n";
+            return 1;
+        }
+
+        request = "RUN " + engine + " " + to_string(source.str().size()) + "\n" + source.str();
+    }
+
+    sockaddr_un address;
+
+    if (!socketAddress(path, address))
+        return 1;
+
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (server < 0 || connect(server, (sockaddr *)&address, sizeof(address)) != 0)
+    {
+        cerr << "division-interpreter: can not connect to " << path << ": " << strerror(errno) << "\n";
+        return 1;
+    }
+
+    Connection connection(server);
+    string line, status, output;
+    size_t size = 0;
+
+    if (!connection.write(request) || !connection.readLine(line) || !(istringstream(line) >> status >> size) ||
+        !connection.read(size, output))
+    {
+        cerr << "division-interpreter: the server closed the connection\n";
+        return 1;
+    }
+
+    close(server);
+
+    if (status == "ERROR")
+    {
+        cerr << "division-interpreter: " << output;
+        return 1;
+    }
+
+    fwrite(output.data(), 1, output.size(), stdout);
+    fflush(stdout);
+
+    if (status == "TRAP")
+        raise(SIGFPE);
+
+    return 0;
+}
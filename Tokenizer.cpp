@@ -1,10 +1,76 @@
 #include <string>
 #include <vector>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <new>
 #include <fstream>
 #include <iostream>
+#include <cstdlib>
+#include <cstdint>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 using namespace std;
 
+/**
+ * Memory for everything created during one compilation: AST nodes and their strings.
+ * Memory is handed out from large blocks and released all at once by reset() or the destructor,
+ * objects that need a destructor call (like the statement vector of ConditionalNode) are
+ * remembered and destroyed at that point.
+ * */
+class Arena
+{
+public:
+    struct Cleanup
+    {
+        void (*destroy)(void *object);
+        void *object;
+        Cleanup *next;
+    };
+
+    vector<pair<char *, size_t>> blocks;
+    char *position; //free part of the current block
+    char *limit;
+    size_t blockSize;
+    Cleanup *cleanups;
+
+    size_t allocations;
+    size_t bytesAllocated; //bytes handed out since the last reset
+    size_t peakBytes;      //largest value of bytesAllocated
+    size_t bytesReserved;  //size of all blocks
+
+    Arena(size_t _blockSize = 1 << 16);
+    ~Arena();
+
+    void *allocate(size_t size, size_t alignment = alignof(void *));
+    const char *copyString(const string &text);
+    void reset();
+
+    /**
+     * Creates an object in the arena
+     * */
+    template <typename T, typename... Args>
+    T *make(Args &&... args)
+    {
+        T *object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+
+        if (!is_trivially_destructible<T>::value)
+        {
+            Cleanup *cleanup = (Cleanup *)allocate(sizeof(Cleanup), alignof(Cleanup));
+            cleanup->destroy = [](void *object) { ((T *)object)->~T(); };
+            cleanup->object = object;
+            cleanup->next = cleanups;
+            cleanups = cleanup;
+        }
+
+        return object;
+    }
+};
+
 enum TokenType
 {
     token_identifier,
@@ -17,41 +83,431 @@ enum TokenType
     token_eof
 };
 
+/**
+ * Operator tokens, the value of each operator is its character
+ * */
+enum OperatorType : char
+{
+    operator_plus = '+',
+    operator_minus = '-',
+    operator_multiply = '*',
+    operator_divide = '/',
+    operator_assign = '=',
+    operator_comma = ',',
+    operator_open_paren = '(',
+    operator_close_paren = ')',
+    operator_open_brace = '{',
+    operator_close_brace = '}'
+};
+
 struct Token
 {
-    string value;
     TokenType type;
     int line;
+    union
+    {
+        OperatorType op; //token_operator, any other character is stored as it is
+        int symbol;      //token_identifier, index of the name in the symbol table
+        int number;      //token_number, value of the literal truncated to i32
+        int conditional; //token_conditional, 0 for if and 1 for while
+    };
+};
+
+/**
+ * Interns identifiers. Every distinct name gets the next symbol index and is stored once in the arena,
+ * the hash table is looked up with the characters in the input buffer so no string is created.
+ * */
+class SymbolTable
+{
+public:
+    Arena *arena;
+    vector<const char *> names;
+    vector<unsigned> hashes;
+    vector<int> lengths;
+    vector<int> table; //open addressing, holds symbol indexes or -1
+
+    SymbolTable(Arena *_arena);
+
+    int intern(const char *text, int length);
+};
+
+/**
+ * Contents of an input file in one contiguous block of memory. Regular files are memory mapped,
+ * other inputs like pipes are read into a buffer with large reads.
+ * */
+class InputBuffer
+{
+public:
+    const char *data;
+    size_t size;
+    bool mapped;
+    char *buffer; //allocated when the input is not mapped
+    bool error;
+    size_t released; //bytes at the start given back by release()
+
+    InputBuffer(string fileName);
+    ~InputBuffer();
+
+    void release(const char *position);
 };
 
 class Tokenizer
 {
 public:
-    ifstream *inputFile;
+    const char *cursor; //next character to read
+    const char *end;
+    bool eof;           //set when a character is read past the end of the input
     char lastChar;
     int line;
 
-    Tokenizer(ifstream *inputFile);
-    ~Tokenizer();
+    SymbolTable symbols;
+
+    Tokenizer(const char *input, size_t size, Arena *arena);
 
-    // void tokenizeInput(ifstream &input);
+    void nextChar();
     Token getNextToken();
 };
 
 
 
 /**
- * Constructor for Tokenizer class
+ * Loads the given file, error is set if it can not be read
  * */
-Tokenizer::Tokenizer(ifstream *inputFile)
+InputBuffer::InputBuffer(string fileName)
 {
-    this->inputFile = inputFile;
+    this->data = "";
+    this->size = 0;
+    this->mapped = false;
+    this->buffer = NULL;
+    this->error = false;
+    this->released = 0;
+
+    int fd = open(fileName.c_str(), O_RDONLY);
+
+    if (fd < 0)
+    {
+        this->error = true;
+        return;
+    }
+
+    struct stat status;
+
+    //Regular files are mapped, nothing is copied
+    if (fstat(fd, &status) == 0 && S_ISREG(status.st_mode))
+    {
+        if (status.st_size > 0)
+        {
+            void *address = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if (address != MAP_FAILED)
+            {
+                madvise(address, status.st_size, MADV_SEQUENTIAL);
+                this->data = (const char *)address;
+                this->size = status.st_size;
+                this->mapped = true;
+            }
+            else
+            {
+                this->error = true;
+            }
+        }
+
+        close(fd);
+        return;
+    }
+
+    //Pipes and other inputs are read in large blocks into a growing buffer
+    size_t capacity = 1 << 20;
+    buffer = (char *)malloc(capacity);
+
+    for (;;)
+    {
+        if (this->size == capacity)
+        {
+            capacity *= 2;
+            buffer = (char *)realloc(buffer, capacity);
+        }
+
+        ssize_t count = read(fd, buffer + this->size, capacity - this->size);
+
+        if (count < 0 && errno == EINTR)
+            continue;
+
+        if (count < 0)
+            this->error = true;
+
+        if (count <= 0)
+            break;
+
+        this->size += count;
+    }
+
+    close(fd);
+    this->data = buffer;
+}
+
+InputBuffer::~InputBuffer()
+{
+    if (this->mapped)
+        munmap((void *)this->data, this->size);
+
+    free(this->buffer);
+}
+
+/**
+ * Tells the kernel that the mapped input before position is not read again, so its pages can leave
+ * memory. Does nothing for inputs read into a buffer. Pages are given back in steps of 1 MB, pages
+ * given back one by one are mapped again by the kernel when the pages after them are read
+ * */
+void InputBuffer::release(const char *position)
+{
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t length = (position - data) / page * page;
+
+    if (!mapped || length < released + (1 << 20))
+        return;
+
+    madvise((void *)(data + released), length - released, MADV_DONTNEED);
+    released = length;
+}
+
+/****************
+ * SymbolTable
+ * **************/
+
+SymbolTable::SymbolTable(Arena *_arena)
+{
+    this->arena = _arena;
+    this->table.assign(1024, -1);
+}
+
+/**
+ * Returns the symbol index of the name, adds the name if it is seen for the first time
+ * */
+int SymbolTable::intern(const char *text, int length)
+{
+    //FNV-1a hash of the name
+    unsigned hash = 2166136261u;
+    for (int i = 0; i < length; i++)
+        hash = (hash ^ (unsigned char)text[i]) * 16777619u;
+
+    size_t mask = table.size() - 1;
+    size_t slot = hash & mask;
+
+    //Linear probing until the name or an empty slot is found
+    while (table[slot] != -1)
+    {
+        int symbol = table[slot];
+
+        if (hashes[symbol] == hash && lengths[symbol] == length && memcmp(names[symbol], text, length) == 0)
+            return symbol;
+
+        slot = (slot + 1) & mask;
+    }
+
+    char *name = (char *)arena->allocate(length + 1, 1);
+    memcpy(name, text, length);
+    name[length] = '\0';
+
+    int symbol = names.size();
+    names.push_back(name);
+    hashes.push_back(hash);
+    lengths.push_back(length);
+    table[slot] = symbol;
+
+    //Keeps the table at most half full
+    if (names.size() * 2 > table.size())
+    {
+        table.assign(table.size() * 2, -1);
+        mask = table.size() - 1;
+
+        for (int i = 0; i < (int)names.size(); i++)
+        {
+            slot = hashes[i] & mask;
+            while (table[slot] != -1)
+                slot = (slot + 1) & mask;
+            table[slot] = i;
+        }
+    }
+
+    return symbol;
+}
+
+/****************
+ * Character classes
+ * **************/
+
+/**
+ * Class of a character, the class of the first character of a token selects the kind of token
+ * */
+enum CharacterClass : unsigned char
+{
+    class_other, //operators and any other character
+    class_letter,
+    class_digit,
+    class_space, //' ', '\t', '\v', '\f' and '\r'
+    class_newline,
+    class_comment //'#'
+};
+
+struct CharacterTable
+{
+    CharacterClass classes[256];
+};
+
+/**
+ * Builds the class of every character, the same as isalpha, isdigit and isspace in the C locale
+ * */
+static constexpr CharacterTable makeCharacterTable()
+{
+    CharacterTable table = {};
+
+    for (int c = 'a'; c <= 'z'; c++)
+        table.classes[c] = class_letter;
+    for (int c = 'A'; c <= 'Z'; c++)
+        table.classes[c] = class_letter;
+    for (int c = '0'; c <= '9'; c++)
+        table.classes[c] = class_digit;
+
+    table.classes[(int)' '] = class_space;
+    table.classes[(int)'\t'] = class_space;
+    table.classes[(int)'\v'] = class_space;
+    table.classes[(int)'\f'] = class_space;
+    table.classes[(int)'\r'] = class_space;
+    table.classes[(int)'\n'] = class_newline;
+    table.classes[(int)'#'] = class_comment;
+
+    return table;
+}
+
+static constexpr CharacterTable characterTable = makeCharacterTable();
+
+static inline CharacterClass characterClass(char c)
+{
+    return characterTable.classes[(unsigned char)c];
+}
+
+static inline bool isAlphanumeric(char c)
+{
+    CharacterClass type = characterClass(c);
+    return type == class_letter || type == class_digit;
+}
+
+/**
+ * Marks every byte of the word that lies strictly between low and high with 0x80, other bytes are 0.
+ * low and high are below 0x80, bytes from 0x80 up are never marked. Bytes do not carry into each other
+ * */
+static inline uint64_t bytesBetween(uint64_t word, uint64_t low, uint64_t high)
+{
+    const uint64_t ones = 0x0101010101010101ull;
+    uint64_t low7 = word & ones * 0x7f;
+
+    return (ones * (0x7f + high) - low7) & ~word & (low7 + ones * (0x7f - low)) & ones * 0x80;
+}
+
+/**
+ * Returns the end of the run of letters and digits that starts at position. While 8 characters are
+ * left they are classified at once in a 64 bit word (SWAR), the rest through the table
+ * */
+static const char *skipAlphanumeric(const char *position, const char *end)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    while (end - position >= 8)
+    {
+        uint64_t word;
+        memcpy(&word, position, 8);
+
+        //Letters are lower case letters once bit 0x20 is set
+        uint64_t alphanumeric = bytesBetween(word | 0x2020202020202020ull, 'a' - 1, 'z' + 1) | bytesBetween(word, '0' - 1, '9' + 1);
+        uint64_t other = ~alphanumeric & 0x8080808080808080ull;
+
+        //The first character of the input is in the lowest byte
+        if (other != 0)
+            return position + __builtin_ctzll(other) / 8;
+
+        position += 8;
+    }
+#endif
+
+    while (position < end && isAlphanumeric(*position))
+        position++;
+
+    return position;
+}
+
+/**
+ * Reads the run of digits that starts at position into number and returns its end. Runs of 8 digits
+ * are found and converted at once in a 64 bit word. Large literals wrap around like the i32 constants
+ * in IR code
+ * */
+static const char *scanDigits(const char *position, const char *end, unsigned &number)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    while (end - position >= 8)
+    {
+        uint64_t word;
+        memcpy(&word, position, 8);
+
+        uint64_t other = ~bytesBetween(word, '0' - 1, '9' + 1) & 0x8080808080808080ull;
+
+        //Fewer than 8 digits are left, they are added one by one without checking them again
+        if (other != 0)
+        {
+            const char *last = position + __builtin_ctzll(other) / 8;
+
+            while (position < last)
+                number = number * 10 + (*position++ - '0');
+
+            return position;
+        }
+
+        //Combines neighbouring digits to 2, 4 and then 8 digit numbers, the first digit is the lowest byte
+        word = (word & 0x0f0f0f0f0f0f0f0full) * 2561 >> 8;
+        word = (word & 0x00ff00ff00ff00ffull) * 6553601 >> 16;
+        word = (word & 0x0000ffff0000ffffull) * 42949672960001ull >> 32;
+
+        number = number * 100000000u + (unsigned)word;
+        position += 8;
+    }
+#endif
+
+    while (position < end && characterClass(*position) == class_digit)
+        number = number * 10 + (*position++ - '0');
+
+    return position;
+}
+
+/****************
+ * Tokenizer
+ * **************/
+
+/**
+ * Constructor for Tokenizer class, identifiers are interned into the given arena
+ * */
+Tokenizer::Tokenizer(const char *input, size_t size, Arena *arena) : symbols(arena)
+{
+    this->cursor = input;
+    this->end = input + size;
+    this->eof = false;
     this->lastChar = ' ';
     this->line = 0;
 }
 
 /**
- * Creates tokens by reading input line by line. 
+ * Reads the next character into lastChar. At the end of input lastChar keeps its value and eof is set
+ * */
+void Tokenizer::nextChar()
+{
+    if (cursor < end)
+        lastChar = *cursor++;
+    else
+        eof = true;
+}
+
+/**
+ * Creates tokens by reading input line by line. The class of the current character selects the
+ * state of the lexer: spaces are skipped, a letter starts an identifier or keyword, a digit a number
+ * and '#' a comment, anything else is an operator.
  * Returns a pointer to Token object 
  * */
 Token Tokenizer::getNextToken()
@@ -59,141 +515,140 @@ Token Tokenizer::getNextToken()
     Token tok;
 
     //Checks if it is the end of file 
-    if (!inputFile->eof())
+    if (!eof)
     {
-        //while it is empty line or end of line increases line count by 1 and returns eol token
-        while (lastChar == '\n' && !inputFile->eof())
+        //if it is end of line increases line count by 1 and returns eol token
+        if (lastChar == '\n')
         {
             //tokenize end of line
-            tok.value = lastChar;
             tok.type = token_eol;
             tok.line = this->line;
 
-            this->inputFile->get(lastChar); //get next char
+            nextChar(); //get next char
             this->line++; //increase line index
 
             return tok;
         }
 
-        //Removes spaces
-        while (isspace(lastChar))
+        //Removes spaces, a line break after spaces only increases the line count
+        CharacterClass type;
+
+        while ((type = characterClass(lastChar)) == class_space || type == class_newline)
         {
             //if the type is end of line increase line index
-            if (lastChar == '\n')
+            if (type == class_newline)
                 this->line++;
 
-            this->inputFile->get(lastChar);
+            nextChar();
             
             //checks if end of file and returns end of file token
-            if (inputFile->eof())
+            if (eof)
             {
                 //tokenize end of file
                 tok.type = token_eof;
-                tok.value = "_";
                 tok.line = this->line;
                 return tok;
             }
         }
 
-        //Checks if the first letter is alphabetic
-        if (isalpha(lastChar))
+        switch (type)
+        {
+        case (class_letter):
         {
+            //finds the end of the alphanumeric run in the buffer, the identifier starts at lastChar
+            const char *start = cursor - 1;
+            cursor = skipAlphanumeric(cursor, end);
 
-            string identifier = "";
-            identifier.push_back(lastChar); //add char to string
+            int length = cursor - start;
 
-            this->inputFile->get(lastChar); //gets new char
+            //Keywords are told apart by their length first
+            tok.type = token_identifier;
 
-            //gets new chars until it is not alphanumeric
-            while (isalnum(lastChar) && !inputFile->eof())
+            switch (length)
             {
-                identifier.push_back(lastChar);
-                this->inputFile->get(lastChar);
+            case (2):
+                if (memcmp(start, "if", 2) == 0)
+                {
+                    tok.type = token_conditional;
+                    tok.conditional = 0;
+                }
+                break;
+            case (5):
+                if (memcmp(start, "while", 5) == 0)
+                {
+                    tok.type = token_conditional;
+                    tok.conditional = 1;
+                }
+                else if (memcmp(start, "print", 5) == 0)
+                    tok.type = token_print;
+                break;
+            case (6):
+                if (memcmp(start, "choose", 6) == 0)
+                    tok.type = token_choose;
+                break;
             }
 
-            //tokenizes the inputs 
-            if (identifier == "if" || identifier == "while")
-            {
-                tok.value = identifier;
-                tok.type = token_conditional;
-            }
-            else if (identifier == "choose")
-            {
-                tok.value = identifier;
-                tok.type = token_choose;
-            }
-            else if (identifier == "print")
-            {
-                tok.value = identifier;
-                tok.type = token_print;
-            }
-            else
-            {
-                tok.value = identifier;
-                tok.type = token_identifier;
-            }
+            if (tok.type == token_identifier)
+                tok.symbol = symbols.intern(start, length);
+
+            nextChar(); //gets the char after the identifier
 
             tok.line = this->line;
             return tok;
         }
 
-        //checks if it is an integer
-        if (isdigit(lastChar))
+        case (class_digit):
         {
-            string number = "";
-            number.push_back(lastChar); //adds char to the string
+            //reads the digit run from the buffer, the number starts at lastChar
+            unsigned number = lastChar - '0';
+            cursor = scanDigits(cursor, end, number);
 
-            this->inputFile->get(lastChar); //gets next char
-
-            //gets char and adds it to string until it is not a digit
-            while (isdigit(lastChar) && !inputFile->eof())
-            {
-                number.push_back(lastChar);
-                this->inputFile->get(lastChar);
-            }
+            nextChar(); //gets the char after the number
 
             //tokenize integer
-            tok.value = number;
             tok.type = token_number;
+            tok.number = (int)number;
             tok.line = this->line;
             return tok;
         }
 
-        //Pass comments
-        if (lastChar == '#')
+        case (class_comment):
         {
-            //pass until it is end of line
-            while (lastChar != '\n')
+            //Pass the comment until it is end of line
+            const char *newline = (const char *)memchr(cursor, '\n', end - cursor);
+
+            //no end of line, returns eof token
+            if (newline == NULL)
             {
-                this->inputFile->get(lastChar);
+                cursor = end;
+                eof = true;
 
-                //check end of file and return eof token
-                if (inputFile->eof())
-                {
-                    //returns eof token
-                    tok.type = token_eof;
-                    tok.value = "_";
-                    inputFile->get(lastChar);
-                    return tok;
-                }
+                tok.type = token_eof;
+                tok.line = this->line;
+                return tok;
             }
-            return getNextToken(); //if it is eol return this function
+
+            cursor = newline + 1;
+            lastChar = '\n';
+            return getNextToken(); //it is eol now, returns its token
         }
 
-        //if it is not an identifier, number or special declaration it is a operator.
-        //tokenize operator and return
-        tok.value.push_back(lastChar);
-        tok.type = token_operator;
-        tok.line = this->line;
+        default:
+            //if it is not an identifier, number or comment it is a operator.
+            //tokenize operator and return
+            tok.type = token_operator;
+            tok.op = (OperatorType)lastChar;
+            tok.line = this->line;
 
-        inputFile->get(lastChar); //get next char
+            nextChar(); //get next char
 
-        return tok;
+            return tok;
+        }
     }
 
     //End of file, return end of file token
     tok.type = token_eof;
-    tok.value = "_";
-    inputFile->get(lastChar);
+    tok.line = this->line;
+    nextChar();
     return tok;
-}
\ No newline at end of file
+}